@@ -23,10 +23,43 @@ inline uint32_t pcg32_random_r(pcg32_random_t* rng)
   return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
 }
 
+// PCG32 initialization with given initial state and stream id
+// initstate: initial state
+// initseq: stream id(different streams never overlap)
+inline void pcg32_srandom_r(pcg32_random_t* rng, uint64_t initstate,
+                            uint64_t initseq)
+{
+  rng->state = 0U;
+  rng->inc = (initseq << 1u) | 1u;
+  pcg32_random_r(rng);
+  rng->state += initstate;
+  pcg32_random_r(rng);
+}
+
+// advance PCG32 state by delta steps in O(log(delta))
+// Brown, F. B. (1994). Random number generation with arbitrary strides.
+inline void pcg32_advance_r(pcg32_random_t* rng, uint64_t delta)
+{
+  uint64_t cur_mult = 6364136223846793005ULL;
+  uint64_t cur_plus = rng->inc | 1;
+  uint64_t acc_mult = 1u;
+  uint64_t acc_plus = 0u;
+  while (delta > 0) {
+    if (delta & 1) {
+      acc_mult *= cur_mult;
+      acc_plus = acc_plus * cur_mult + cur_plus;
+    }
+    cur_plus = (cur_mult + 1) * cur_plus;
+    cur_mult *= cur_mult;
+    delta /= 2;
+  }
+  rng->state = acc_mult * rng->state + acc_plus;
+}
+
 class Sampler
 {
  public:
-  Sampler(uint64_t seed)
+  Sampler(uint64_t seed) : m_seed(seed)
   {
     state.state = seed;
     state.inc = 0xdeadbeef;
@@ -35,6 +68,16 @@ class Sampler
     for (int i = 0; i < 10; ++i) { next_1d(); }
   }
 
+  // start random number sequence of given pixel and sample index
+  // sequence depends only on (seed, pixel_index, sample_index), so the result
+  // is the same regardless of thread count or schedule
+  // each pixel uses its own PCG stream, and each sample skips 2^16 numbers
+  void startPixelSample(uint32_t pixel_index, uint32_t sample_index)
+  {
+    pcg32_srandom_r(&state, m_seed, pixel_index);
+    pcg32_advance_r(&state, static_cast<uint64_t>(sample_index) << 16);
+  }
+
   // generate 1d float sample
   float next_1d() { return pcg32_random_r(&state) * (1.0f / (1ULL << 32)); }
 
@@ -42,5 +85,6 @@ class Sampler
   glm::vec2 next_2d() { return glm::vec2(next_1d(), next_1d()); }
 
  private:
+  uint64_t m_seed;  // seed of random number sequence
   pcg32_random_t state;
 };
\ No newline at end of file
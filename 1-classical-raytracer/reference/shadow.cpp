@@ -33,10 +33,12 @@ int main()
 
   glm::vec3 sun_direction = glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f));
 
-#pragma omp parallel for collapse(2)
+#pragma omp parallel for collapse(2) firstprivate(sampler)
   for (int j = 0; j < height; ++j) {
     for (int i = 0; i < width; ++i) {
       for (int k = 0; k < n_samples; ++k) {
+        sampler.startPixelSample(i + width * j, k);
+
         glm::vec2 ndc =
             glm::vec2((2.0f * (i + sampler.next_1d()) - width) / height,
                       (2.0f * (j + sampler.next_1d()) - height) / height);
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
@@ -11,27 +12,26 @@
 inline void write_ppm(const std::string& filename, int width, int height,
                       const float* image)
 {
-  std::ofstream file(filename);
-  if (!file.is_open()) {
-    throw std::runtime_error("failed to open " + filename);
-  }
+  const std::string header = "P6\n" + std::to_string(width) + " " +
+                             std::to_string(height) + "\n255\n";
 
-  file << "P3" << std::endl;
-  file << width << " " << height << std::endl;
-  file << "255" << std::endl;
+  std::vector<unsigned char> data(header.size() + 3 * width * height);
+  std::memcpy(data.data(), header.data(), header.size());
+  unsigned char* pixels = data.data() + header.size();
+#pragma omp parallel for
   for (int j = 0; j < height; ++j) {
-    for (int i = 0; i < width; ++i) {
-      const int idx = 3 * i + 3 * width * j;
-      const float R = image[idx];
-      const float G = image[idx + 1];
-      const float B = image[idx + 2];
-      file << glm::clamp(static_cast<int>(255.0f * R), 0, 255) << " "
-           << glm::clamp(static_cast<int>(255.0f * G), 0, 255) << " "
-           << glm::clamp(static_cast<int>(255.0f * B), 0, 255) << std::endl;
+    for (int i = 0; i < 3 * width; ++i) {
+      const int idx = i + 3 * width * j;
+      pixels[idx] = glm::clamp(static_cast<int>(255.0f * image[idx]), 0, 255);
     }
   }
 
-  file.close();
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open " + filename);
+  }
+  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  if (!file) { throw std::runtime_error("failed to write " + filename); }
 }
 
 inline void write_png(const std::string& filename, int width, int height,
@@ -26,9 +26,11 @@ int main()
 
   Sampler sampler(12);
 
-#pragma omp parallel for collapse(2)
+#pragma omp parallel for collapse(2) firstprivate(sampler)
   for (int j = 0; j < height; ++j) {
     for (int i = 0; i < width; ++i) {
+      sampler.startPixelSample(i + width * j, 0);
+
       glm::vec2 ndc =
           glm::vec2((2.0f * i - width) / height, (2.0f * j - height) / height);
       ndc.y *= -1.0f;
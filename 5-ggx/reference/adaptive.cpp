@@ -0,0 +1,56 @@
+#include "adaptive.h"
+#include "bsdf.h"
+#include "camera.h"
+#include "core.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "io.h"
+#include "primitive.h"
+#include "sampler.h"
+#include "scene.h"
+
+int main()
+{
+  const int width = 512;
+  const int height = 512;
+  const int min_samples = 16;
+  const int max_samples = 400;
+  const int samples_per_round = 16;
+  const float target_error = 0.02f;
+  const int max_depth = 10;
+
+  Image image(width, height);
+  PinholeCamera camera(glm::vec3(0, 1, 3), glm::vec3(0, 0, -1), 0.33f * M_PIf);
+
+  Scene scene;
+  scene.loadObj("./CornellBox.obj");
+
+  BVHOptimized intersector(scene.m_primitives.data(),
+                           scene.m_primitives.size());
+  intersector.buildBVH();
+
+  IBL sky("PaperMill_E_3k.hdr");
+
+  SobolSampler sampler(12);
+
+  PathTracing integrator(max_depth);
+
+  AdaptiveRendering renderer(min_samples, max_samples, samples_per_round,
+                             target_error);
+  renderer.render(camera, integrator, intersector, sky, sampler, image);
+
+  write_png("output.png", width, height, image.getConstPtr(), PostProcess());
+
+  // visualize number of samples
+  Image sample_count(width, height);
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      const float n = renderer.getSampleCount(i + width * j);
+      sample_count.setPixel(i, j, glm::vec3(n / max_samples));
+    }
+  }
+  write_png("samples.png", width, height, sample_count.getConstPtr());
+
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "aov.h"
+#include "bsdf.h"
+#include "camera.h"
+#include "core.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "io.h"
+#include "primitive.h"
+#include "sampler.h"
+#include "scene.h"
+#include "tile.h"
+
+// render image and AOVs in one pass
+// each AOV is written to aov_<name>.png
+// usage: aov [name]...
+// name: albedo, normal, depth, primitive_id, material_id, sample_count or
+// bvh_cost. all AOVs are written if no name is given.
+int main(int argc, char** argv)
+{
+  const int width = 512;
+  const int height = 512;
+  const int n_samples = 16;
+  const int max_depth = 10;
+  const int tile_size = 16;
+
+  std::vector<AOV> aovs;
+  try {
+    for (int k = 1; k < argc; ++k) { aovs.push_back(parse_aov(argv[k])); }
+  } catch (const std::exception& e) {
+    spdlog::error("[aov] {}", e.what());
+    return EXIT_FAILURE;
+  }
+  if (aovs.empty()) {
+    for (int k = 0; k < N_AOVS; ++k) { aovs.push_back(static_cast<AOV>(k)); }
+  }
+
+  Image image(width, height);
+  AOVBuffer aov_buffer(width, height, aovs);
+  PinholeCamera camera(glm::vec3(0, 1, 3), glm::vec3(0, 0, -1), 0.33f * M_PIf);
+
+  Scene scene;
+  scene.loadObj("./CornellBox.obj");
+
+  BVHOptimized intersector(scene.m_primitives.data(),
+                           scene.m_primitives.size());
+  intersector.buildBVH();
+
+  IBL sky("PaperMill_E_3k.hdr");
+
+  SobolSampler sampler(12);
+
+  PathTracing integrator(max_depth);
+
+  TileScheduler scheduler(width, height, tile_size);
+  std::vector<SobolSampler> samplers(scheduler.getNumThreads(), sampler);
+
+  scheduler.render(image, [&](const Tile& tile, int thread_id,
+                              TileAccumulator& accumulation) {
+    SobolSampler& sampler = samplers[thread_id];
+    for (int j = tile.y0; j < tile.y1; ++j) {
+      for (int i = tile.x0; i < tile.x1; ++i) {
+        render_pixel(i, j, 0, n_samples, width, height, camera, integrator,
+                     intersector, sky, sampler, accumulation, &aov_buffer);
+      }
+    }
+  });
+  scheduler.logStatistics();
+  image.divide(n_samples);
+  aov_buffer.resolve();
+
+  write_png("output.png", width, height, image.getConstPtr(), PostProcess());
+
+  Image aov_image(width, height);
+  for (const AOV aov : aovs) {
+    visualize_aov(aov_buffer, aov, aov_image);
+    const std::string filename = std::string("aov_") + aov_name(aov) + ".png";
+    write_png(filename, width, height, aov_image.getConstPtr(), PostProcess());
+    spdlog::info("[aov] {}", filename);
+  }
+
+  return 0;
+}
\ No newline at end of file
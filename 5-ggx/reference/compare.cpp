@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "io.h"
+#include "metrics.h"
+#include "postprocess.h"
+#include "spdlog/spdlog.h"
+
+// options of comparison, given as key=value
+struct CompareOptions {
+  float exposure = 0.0f;                     // exposure compensation in EV
+  Tonemapper tonemapper = Tonemapper::NONE;  // tone mapping before FLIP
+  float ppd = 67.0f;                         // pixels per degree of FLIP
+  std::string heatmap_filepath;              // output of heatmap, if given
+  std::string heatmap_metric = "flip";       // metric of heatmap
+  int tile_size = 16;                        // tile size of heatmap
+  int n_samples = 0;                         // samples per pixel of image
+  double time = 0.0;                         // render time of image
+  double target_rel_mse = 1e-3;              // relMSE of time to target
+  double max_rel_mse = -1.0;                 // gate, ignored if negative
+  double max_flip = -1.0;                    // gate, ignored if negative
+  double min_efficiency = -1.0;              // gate, ignored if negative
+};
+
+CompareOptions parse_options(int argc, char** argv)
+{
+  CompareOptions options;
+  for (int k = 3; k < argc; ++k) {
+    const std::string token = argv[k];
+    const size_t eq = token.find('=');
+    if (eq == std::string::npos) {
+      throw std::runtime_error("invalid option " + token);
+    }
+    const std::string key = token.substr(0, eq);
+    const std::string value = token.substr(eq + 1);
+
+    if (key == "exposure") {
+      options.exposure = std::stof(value);
+    } else if (key == "tonemap") {
+      options.tonemapper = parse_tonemapper(value);
+    } else if (key == "ppd") {
+      options.ppd = std::stof(value);
+    } else if (key == "heatmap") {
+      options.heatmap_filepath = value;
+    } else if (key == "metric") {
+      if (value != "mse" && value != "relmse" && value != "flip") {
+        throw std::runtime_error("unknown metric " + value);
+      }
+      options.heatmap_metric = value;
+    } else if (key == "tile") {
+      options.tile_size = std::max(std::stoi(value), 1);
+    } else if (key == "spp") {
+      options.n_samples = std::stoi(value);
+    } else if (key == "time") {
+      options.time = std::stod(value);
+    } else if (key == "target") {
+      options.target_rel_mse = std::stod(value);
+    } else if (key == "max_relmse") {
+      options.max_rel_mse = std::stod(value);
+    } else if (key == "max_flip") {
+      options.max_flip = std::stod(value);
+    } else if (key == "min_efficiency") {
+      options.min_efficiency = std::stod(value);
+    } else {
+      throw std::runtime_error("unknown option " + key);
+    }
+  }
+  if (options.min_efficiency >= 0.0 && options.time <= 0.0) {
+    throw std::runtime_error("min_efficiency requires time");
+  }
+  return options;
+}
+
+// compare rendered image with reference, and check it as benchmark gate
+// usage: compare <image> <reference> [key=value]...
+// images are linear radiance(.exr or .pfm). keys are
+//   exposure=<EV> tonemap=<name>: post process before FLIP(0, none)
+//   ppd=<pixels per degree>: viewing condition of FLIP(67)
+//   heatmap=<png> metric=<mse|relmse|flip> tile=<size>: write per tile mean
+//     error of metric(flip, 16)
+//   spp=<n> time=<seconds>: samples per pixel and render time of image
+//   target=<relMSE>: relMSE of reported time to target(1e-3)
+//   max_relmse=<x> max_flip=<x> min_efficiency=<x>: exit with failure if
+//     error is larger or efficiency is smaller
+// efficiency is 1 / (relMSE * time). relMSE of unbiased render is inversely
+// proportional to number of samples, so that renders with different sample
+// counts are compared at equal error by efficiency or time to target.
+int main(int argc, char** argv)
+{
+  if (argc < 3) {
+    spdlog::error("usage: {} <image> <reference> [key=value]...", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  try {
+    const CompareOptions options = parse_options(argc, argv);
+
+    int width, height, reference_width, reference_height;
+    const std::vector<float> image = read_image(argv[1], width, height);
+    const std::vector<float> reference =
+        read_image(argv[2], reference_width, reference_height);
+    if (width != reference_width || height != reference_height) {
+      throw std::runtime_error("image size doesn't match");
+    }
+    spdlog::info("[compare] {}x{}", width, height);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const std::vector<float> se_map =
+        squared_error_map(image.data(), reference.data(), width, height, false);
+    const std::vector<float> rel_se_map =
+        squared_error_map(image.data(), reference.data(), width, height, true);
+
+    // FLIP compares post processed images
+    const PostProcess post_process(options.exposure, options.tonemapper);
+    std::vector<float> image_srgb(image), reference_srgb(reference);
+    post_process.apply(image_srgb.data(), width, height);
+    post_process.apply(reference_srgb.data(), width, height);
+    const std::vector<float> flip_map = FlipMetric(options.ppd).computeMap(
+        image_srgb.data(), reference_srgb.data(), width, height);
+
+    const double mse = mean_error(se_map);
+    const double rel_mse = mean_error(rel_se_map);
+    const double flip = mean_error(flip_map);
+
+    spdlog::info("[compare] computed in {:.3f}s",
+                 std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count());
+    spdlog::info("[compare] MSE: {:.6e}", mse);
+    spdlog::info("[compare] relMSE: {:.6e}", rel_mse);
+    spdlog::info("[compare] FLIP: {:.6f}", flip);
+
+    // per tile error
+    const std::vector<float>& map = options.heatmap_metric == "mse"
+                                        ? se_map
+                                        : options.heatmap_metric == "relmse"
+                                              ? rel_se_map
+                                              : flip_map;
+    const std::vector<float> errors =
+        tile_errors(map, width, height, options.tile_size);
+    std::vector<int> order(errors.size());
+    std::iota(order.begin(), order.end(), 0);
+    const int n_worst = std::min<int>(5, order.size());
+    std::partial_sort(order.begin(), order.begin() + n_worst, order.end(),
+                      [&](int a, int b) { return errors[a] > errors[b]; });
+    const int n_tiles_x = (width + options.tile_size - 1) / options.tile_size;
+    for (int k = 0; k < n_worst; ++k) {
+      spdlog::info("[compare] worst tile ({}, {}): {} {:.6e}",
+                   order[k] % n_tiles_x * options.tile_size,
+                   order[k] / n_tiles_x * options.tile_size,
+                   options.heatmap_metric, errors[order[k]]);
+    }
+    if (!options.heatmap_filepath.empty()) {
+      // colors are normalized by worst tile
+      write_png_rgb8(options.heatmap_filepath, width, height,
+                     make_tile_heatmap(errors, width, height,
+                                       options.tile_size, errors[order[0]])
+                         .data());
+    }
+
+    // efficiency at equal error
+    double efficiency = 0.0;
+    if (options.time > 0.0) {
+      efficiency = 1.0 / (rel_mse * options.time);
+      spdlog::info("[compare] efficiency(1 / (relMSE * time)): {:.6e}",
+                   efficiency);
+      spdlog::info("[compare] time to relMSE {:.3e}: {:.3f}s",
+                   options.target_rel_mse,
+                   options.time * rel_mse / options.target_rel_mse);
+      if (options.n_samples > 0) {
+        spdlog::info("[compare] samples per second: {:.6e}",
+                     static_cast<double>(options.n_samples) * width * height /
+                         options.time);
+      }
+    }
+
+    // benchmark gate
+    bool passed = true;
+    if (options.max_rel_mse >= 0.0 && rel_mse > options.max_rel_mse) {
+      spdlog::error("[compare] relMSE {:.6e} exceeds {:.6e}", rel_mse,
+                    options.max_rel_mse);
+      passed = false;
+    }
+    if (options.max_flip >= 0.0 && flip > options.max_flip) {
+      spdlog::error("[compare] FLIP {:.6f} exceeds {:.6f}", flip,
+                    options.max_flip);
+      passed = false;
+    }
+    if (options.min_efficiency >= 0.0 &&
+        efficiency < options.min_efficiency) {
+      spdlog::error("[compare] efficiency {:.6e} is below {:.6e}", efficiency,
+                    options.min_efficiency);
+      passed = false;
+    }
+    if (!passed) { return EXIT_FAILURE; }
+  } catch (const std::exception& e) {
+    spdlog::error("[compare] {}", e.what());
+    return EXIT_FAILURE;
+  }
+
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include <cstdlib>
+#include <string>
+
+#include "accumulation.h"
+#include "bsdf.h"
+#include "camera.h"
+#include "core.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "primitive.h"
+#include "sampler.h"
+#include "scene.h"
+#include "tile.h"
+
+// render part of image as one process of distributed rendering
+// usage: distributed <rank> <n_ranks> <tiles|samples> <output>
+// tiles: each process renders disjoint tile set with all samples
+// samples: each process renders all tiles with disjoint range of sample index
+// partial results are combined by merge
+int main(int argc, char** argv)
+{
+  if (argc != 5) {
+    spdlog::error("usage: {} <rank> <n_ranks> <tiles|samples> <output>",
+                  argv[0]);
+    return EXIT_FAILURE;
+  }
+  const int rank = std::stoi(argv[1]);
+  const int n_ranks = std::stoi(argv[2]);
+  const std::string mode = argv[3];
+  const std::string output_filename = argv[4];
+  if (n_ranks <= 0 || rank < 0 || rank >= n_ranks ||
+      (mode != "tiles" && mode != "samples")) {
+    spdlog::error("invalid arguments");
+    return EXIT_FAILURE;
+  }
+
+  const int width = 512;
+  const int height = 512;
+  const int n_samples = 100;
+  const int max_depth = 10;
+  const int tile_size = 16;
+
+  PinholeCamera camera(glm::vec3(0, 1, 3), glm::vec3(0, 0, -1), 0.33f * M_PIf);
+
+  Scene scene;
+  scene.loadObj("./CornellBox.obj");
+
+  BVHOptimized intersector(scene.m_primitives.data(),
+                           scene.m_primitives.size());
+  intersector.buildBVH();
+
+  IBL sky("PaperMill_E_3k.hdr");
+
+  SobolSampler sampler(12);
+
+  PathTracing integrator(max_depth);
+
+  TileScheduler scheduler(width, height, tile_size);
+
+  // range of sample index rendered by this process
+  uint32_t sample_start = 0;
+  uint32_t sample_end = n_samples;
+  if (mode == "tiles") {
+    scheduler.partition(rank, n_ranks);
+  } else {
+    sample_start = n_samples * rank / n_ranks;
+    sample_end = n_samples * (rank + 1) / n_ranks;
+  }
+  spdlog::info("[distributed] rank {}/{}: samples [{}, {})", rank, n_ranks,
+               sample_start, sample_end);
+
+  Accumulation accumulation(width, height, sampler.getSeed(), sample_start,
+                            sample_end);
+  std::vector<SobolSampler> samplers(scheduler.getNumThreads(), sampler);
+
+  // sums are flushed to accumulation in double, and rounded only by merge
+  // pixels of tiles not rendered by this process stay 0
+  scheduler.render(accumulation.sum, [&](const Tile& tile, int thread_id,
+                              TileAccumulator& tile_accumulation) {
+    SobolSampler& sampler = samplers[thread_id];
+    for (int j = tile.y0; j < tile.y1; ++j) {
+      for (int i = tile.x0; i < tile.x1; ++i) {
+        // sample sequence depends only on (seed, pixel, sample index), so
+        // any partition gives same samples as single process
+        render_pixel(i, j, sample_start, sample_end, width, height, camera,
+                     integrator, intersector, sky, sampler, tile_accumulation);
+
+        // tiles don't overlap, so no synchronization is needed
+        accumulation.sample_counts[i + width * j] = sample_end - sample_start;
+      }
+    }
+  });
+  scheduler.logStatistics();
+
+  write_accumulation(output_filename, accumulation);
+
+  return 0;
+}
\ No newline at end of file
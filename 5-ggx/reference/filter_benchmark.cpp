@@ -0,0 +1,116 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "camera.h"
+#include "core.h"
+#include "film.h"
+#include "filter.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "io.h"
+#include "metrics.h"
+#include "primitive.h"
+#include "sampler.h"
+#include "scene.h"
+#include "spdlog/spdlog.h"
+#include "tile.h"
+
+// compare convergence of reconstruction filters at equal sample counts
+// each filter converges to its own image, so error is measured against
+// reference rendered with same filter and another seed, which shows noise
+// only. error is also measured against common box reference, which is
+// integral of radiance over each pixel, so that blur is counted too.
+// usage: filter_benchmark [filter]...
+int main(int argc, char** argv)
+{
+  const int width = 256;
+  const int height = 256;
+  const int max_depth = 10;
+  const int tile_size = 16;
+  const int n_reference_samples = 1024;
+  const std::vector<int> sample_counts = {1, 4, 16, 64};
+
+  std::vector<std::string> filter_names = {"box", "gaussian", "mitchell",
+                                           "blackman_harris"};
+  if (argc > 1) { filter_names.assign(argv + 1, argv + argc); }
+
+  PinholeCamera camera(glm::vec3(0, 1, 3), glm::vec3(0, 0, -1), 0.33f * M_PIf);
+
+  Scene scene;
+  scene.loadObj("./CornellBox.obj");
+
+  BVHOptimized intersector(scene.m_primitives.data(),
+                           scene.m_primitives.size());
+  intersector.buildBVH();
+
+  IBL sky("PaperMill_E_3k.hdr");
+
+  PathTracing integrator(max_depth);
+
+  TileScheduler scheduler(width, height, tile_size);
+
+  // render image with n_samples per pixel, and return time in seconds
+  const auto render = [&](const Filter& filter, uint64_t seed, int n_samples,
+                          Image& image) {
+    const auto start = std::chrono::steady_clock::now();
+
+    Film film(width, height, filter);
+    std::vector<SobolSampler> samplers(scheduler.getNumThreads(),
+                                       SobolSampler(seed));
+    scheduler.render(film, [&](const Tile& tile, int thread_id,
+                               TileAccumulator& accumulation) {
+      SobolSampler& sampler = samplers[thread_id];
+      for (int j = tile.y0; j < tile.y1; ++j) {
+        for (int i = tile.x0; i < tile.x1; ++i) {
+          render_pixel(i, j, 0, n_samples, width, height, camera, integrator,
+                       intersector, sky, sampler, accumulation);
+        }
+      }
+    });
+    film.resolve(image);
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  };
+
+  // common reference of all filters
+  Image box_reference(width, height);
+  render(*make_filter("box"), 1, n_reference_samples, box_reference);
+
+  for (const std::string& name : filter_names) {
+    const std::unique_ptr<Filter> filter = make_filter(name);
+
+    // box filter reuses common reference
+    Image filter_reference(width, height);
+    if (name != "box") {
+      render(*filter, 1, n_reference_samples, filter_reference);
+    }
+    const Image& reference = name == "box" ? box_reference : filter_reference;
+    write_png("filter_" + name + ".png", width, height,
+              reference.getConstPtr(), PostProcess());
+
+    // relMSE of filter's own reference to box reference, which is bias
+    // left after infinite samples
+    spdlog::info("[{}] reference: relMSE to box {:.5f}", name,
+                 rel_mse(reference.getConstPtr(), box_reference.getConstPtr(),
+                         width, height));
+
+    for (const int n_samples : sample_counts) {
+      Image image(width, height);
+      const double time = render(*filter, 12, n_samples, image);
+      const double error = rel_mse(image.getConstPtr(),
+                                   reference.getConstPtr(), width, height);
+      const double box_error =
+          rel_mse(image.getConstPtr(), box_reference.getConstPtr(), width,
+                  height);
+      spdlog::info("[{}] {} spp: relMSE {:.5f}, relMSE to box {:.5f}, {:.3f}s",
+                   name, n_samples, error, box_error, time);
+    }
+  }
+
+  return 0;
+}
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "primitive.h"
 #include "sampler.h"
 #include "scene.h"
+#include "tile.h"
 
 int main()
 {
@@ -15,6 +16,7 @@ int main()
   const int height = 512;
   const int n_samples = 100;
   const int max_depth = 10;
+  const int tile_size = 16;
 
   Image image(width, height);
   PinholeCamera camera(glm::vec3(0, 1, 3), glm::vec3(0, 0, -1), 0.33f * M_PIf);
@@ -28,36 +30,28 @@ int main()
 
   IBL sky("PaperMill_E_3k.hdr");
 
-  Sampler sampler(12);
+  SobolSampler sampler(12);
 
   PathTracing integrator(max_depth);
 
-#pragma omp parallel for collapse(2)
-  for (int j = 0; j < height; ++j) {
-    for (int i = 0; i < width; ++i) {
-      for (int k = 0; k < n_samples; ++k) {
-        glm::vec2 ndc =
-            glm::vec2((2.0f * (i + sampler.next_1d()) - width) / height,
-                      (2.0f * (j + sampler.next_1d()) - height) / height);
-        ndc.y *= -1.0f;
-
-        // sample ray from camera
-        const Ray ray = camera.sampleRay(ndc, sampler.next_2d());
-
-        // evaluate incoming radiance
-        const glm::vec3 radiance =
-            integrator.integrate(ray, intersector, sky, sampler);
-
-        if (!isinf(radiance) && !isnan(radiance)) {
-          image.addPixel(i, j, radiance);
-        }
+  TileScheduler scheduler(width, height, tile_size);
+  std::vector<SobolSampler> samplers(scheduler.getNumThreads(), sampler);
+
+  scheduler.render(image, [&](const Tile& tile, int thread_id,
+                              TileAccumulator& accumulation) {
+    SobolSampler& sampler = samplers[thread_id];
+    for (int j = tile.y0; j < tile.y1; ++j) {
+      for (int i = tile.x0; i < tile.x1; ++i) {
+        render_pixel(i, j, 0, n_samples, width, height, camera, integrator,
+                     intersector, sky, sampler, accumulation);
       }
     }
-  }
+  });
+  scheduler.logStatistics();
   image.divide(n_samples);
+  write_exr("output.exr", width, height, image.getConstPtr());
 
-  image.post_process();
-  write_png("output.png", width, height, image.getConstPtr());
+  write_png("output.png", width, height, image.getConstPtr(), PostProcess());
 
   return 0;
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #pragma once
+#include <algorithm>
+
 #include "core.h"
 #include "glm/glm.hpp"
 
@@ -84,4 +86,42 @@ struct AABB {
     }
     return ret;
   }
-};
\ No newline at end of file
+};
+
+// bounding box of elements in [first, last), which must not be empty
+// get_bounds(element): bounding box of element
+template <typename Iterator, typename F>
+inline AABB merge_bounds(Iterator first, Iterator last, F get_bounds)
+{
+  AABB bbox = get_bounds(*first);
+  for (Iterator it = first + 1; it != last; ++it) {
+    bbox = bbox.mergeAABB(get_bounds(*it));
+  }
+  return bbox;
+}
+
+// split of BVH builders
+// partition elements in [first, last) at median of their centers along the
+// longest axis of the centers
+// NOTE: using bounds instead of centers doesn't work well when splitting
+// get_bounds(element): bounding box of element
+// split_axis: axis of split
+// return: first element of second half
+template <typename Iterator, typename F>
+inline Iterator split_at_median(Iterator first, Iterator last, F get_bounds,
+                                int& split_axis)
+{
+  const glm::vec3 center = get_bounds(*first).center();
+  AABB split_bbox(center, center);
+  for (Iterator it = first + 1; it != last; ++it) {
+    split_bbox = split_bbox.mergeAABB(get_bounds(*it).center());
+  }
+  split_axis = split_bbox.logestAxis();
+
+  const Iterator split = first + (last - first) / 2;
+  std::nth_element(first, split, last, [&](const auto& e1, const auto& e2) {
+    return get_bounds(e1).center()[split_axis] <
+           get_bounds(e2).center()[split_axis];
+  });
+  return split;
+}
\ No newline at end of file
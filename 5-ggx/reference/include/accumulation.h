@@ -0,0 +1,172 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "image.h"
+#include "spdlog/spdlog.h"
+
+// sum of radiance and number of samples of each pixel, rendered by one
+// process of distributed rendering
+// pixels which are not rendered by the process have 0 samples
+// sum is kept in double, so that merged sum equals sum of single process
+// render up to rounding of double, and is rounded to float only at resolve
+struct Accumulation {
+  uint32_t width = 0;                   // width of image
+  uint32_t height = 0;                  // height of image
+  uint64_t sampler_seed = 0;            // seed of sampler
+  uint32_t sample_start = 0;            // first sample index rendered
+  uint32_t sample_end = 0;              // end of sample index rendered
+  std::vector<double> sum;              // sum of radiance(RGB)
+  std::vector<uint32_t> sample_counts;  // number of samples of each pixel
+
+  Accumulation() {}
+  Accumulation(uint32_t width, uint32_t height, uint64_t sampler_seed,
+               uint32_t sample_start, uint32_t sample_end)
+      : width(width),
+        height(height),
+        sampler_seed(sampler_seed),
+        sample_start(sample_start),
+        sample_end(sample_end),
+        sum(3 * width * height, 0.0),
+        sample_counts(width * height, 0)
+  {
+  }
+
+  // true if both accumulations have same sample of some pixel
+  // sample is identified by (seed, pixel, sample index), so such inputs are
+  // duplicates and merging them would count the sample twice
+  bool overlaps(const Accumulation& other) const
+  {
+    if (other.width != width || other.height != height) {
+      throw std::runtime_error("image size of accumulation doesn't match");
+    }
+    if (other.sampler_seed != sampler_seed ||
+        other.sample_start >= sample_end || sample_start >= other.sample_end) {
+      return false;
+    }
+    for (size_t k = 0; k < sample_counts.size(); ++k) {
+      if (sample_counts[k] > 0 && other.sample_counts[k] > 0) { return true; }
+    }
+    return false;
+  }
+
+  // add other accumulation of same image
+  // sample range becomes the range covering both
+  void merge(const Accumulation& other)
+  {
+    if (other.width != width || other.height != height) {
+      throw std::runtime_error("image size of accumulation doesn't match");
+    }
+    if (other.sampler_seed != sampler_seed) {
+      throw std::runtime_error("sampler seed of accumulation doesn't match");
+    }
+    sample_start = glm::min(sample_start, other.sample_start);
+    sample_end = glm::max(sample_end, other.sample_end);
+    for (size_t k = 0; k < sum.size(); ++k) { sum[k] += other.sum[k]; }
+    for (size_t k = 0; k < sample_counts.size(); ++k) {
+      sample_counts[k] += other.sample_counts[k];
+    }
+  }
+
+  // set mean radiance of each pixel to image
+  // return: number of pixels without samples
+  uint32_t resolve(Image& image) const
+  {
+    uint32_t n_empty = 0;
+    for (uint32_t j = 0; j < height; ++j) {
+      for (uint32_t i = 0; i < width; ++i) {
+        const uint32_t idx = i + width * j;
+        if (sample_counts[idx] == 0) {
+          image.setPixel(i, j, glm::vec3(0.0f));
+          n_empty++;
+          continue;
+        }
+        const glm::dvec3 sum_pixel(sum[3 * idx + 0], sum[3 * idx + 1],
+                                   sum[3 * idx + 2]);
+        image.setPixel(
+            i, j,
+            glm::vec3(sum_pixel / static_cast<double>(sample_counts[idx])));
+      }
+    }
+    return n_empty;
+  }
+};
+
+// magic number and version of accumulation file
+constexpr char ACCUMULATION_MAGIC[4] = {'P', 'T', 'A', 'C'};
+constexpr uint32_t ACCUMULATION_VERSION = 2;
+
+// write accumulation to binary file
+inline void write_accumulation(const std::filesystem::path& filepath,
+                               const Accumulation& accumulation)
+{
+  std::ofstream file(filepath, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open " + filepath.string());
+  }
+
+  const auto write = [&](const void* data, size_t size) {
+    file.write(reinterpret_cast<const char*>(data), size);
+  };
+  write(ACCUMULATION_MAGIC, sizeof(ACCUMULATION_MAGIC));
+  write(&ACCUMULATION_VERSION, sizeof(ACCUMULATION_VERSION));
+  write(&accumulation.width, sizeof(accumulation.width));
+  write(&accumulation.height, sizeof(accumulation.height));
+  write(&accumulation.sampler_seed, sizeof(accumulation.sampler_seed));
+  write(&accumulation.sample_start, sizeof(accumulation.sample_start));
+  write(&accumulation.sample_end, sizeof(accumulation.sample_end));
+  write(accumulation.sum.data(), accumulation.sum.size() * sizeof(double));
+  write(accumulation.sample_counts.data(),
+        accumulation.sample_counts.size() * sizeof(uint32_t));
+
+  if (!file) {
+    throw std::runtime_error("failed to write " + filepath.string());
+  }
+}
+
+// read accumulation from binary file
+inline Accumulation read_accumulation(const std::filesystem::path& filepath)
+{
+  std::ifstream file(filepath, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open " + filepath.string());
+  }
+
+  const auto read = [&](void* data, size_t size) {
+    file.read(reinterpret_cast<char*>(data), size);
+    if (!file) {
+      throw std::runtime_error("broken accumulation " + filepath.string());
+    }
+  };
+
+  char magic[4];
+  uint32_t version;
+  read(magic, sizeof(magic));
+  read(&version, sizeof(version));
+  if (std::memcmp(magic, ACCUMULATION_MAGIC, sizeof(magic)) != 0 ||
+      version != ACCUMULATION_VERSION) {
+    throw std::runtime_error("unsupported accumulation " + filepath.string());
+  }
+
+  Accumulation accumulation;
+  read(&accumulation.width, sizeof(accumulation.width));
+  read(&accumulation.height, sizeof(accumulation.height));
+  read(&accumulation.sampler_seed, sizeof(accumulation.sampler_seed));
+  read(&accumulation.sample_start, sizeof(accumulation.sample_start));
+  read(&accumulation.sample_end, sizeof(accumulation.sample_end));
+
+  const size_t n_pixels = accumulation.width * accumulation.height;
+  accumulation.sum.resize(3 * n_pixels);
+  accumulation.sample_counts.resize(n_pixels);
+  read(accumulation.sum.data(), accumulation.sum.size() * sizeof(double));
+  read(accumulation.sample_counts.data(),
+       accumulation.sample_counts.size() * sizeof(uint32_t));
+
+  return accumulation;
+}
\ No newline at end of file
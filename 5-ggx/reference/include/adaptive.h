@@ -0,0 +1,168 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "camera.h"
+#include "core.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "sampler.h"
+#include "sky.h"
+#include "spdlog/spdlog.h"
+
+// running mean and variance of pixel samples(Welford's algorithm)
+struct PixelStatistics {
+  uint32_t n_samples = 0;               // number of samples
+  glm::vec3 mean = glm::vec3(0.0f);     // mean of radiance
+  double luminance_mean = 0.0;          // mean of luminance
+  double luminance_m2 = 0.0;            // sum of squared deviation
+
+  void add(const glm::vec3& radiance)
+  {
+    n_samples++;
+    mean += (radiance - mean) / static_cast<float>(n_samples);
+
+    const double l = luminance(radiance);
+    const double delta = l - luminance_mean;
+    luminance_mean += delta / n_samples;
+    luminance_m2 += delta * (l - luminance_mean);
+  }
+
+  // relative standard error of mean luminance
+  // eps: avoids dark pixels never converging
+  float relativeError(float eps) const
+  {
+    if (n_samples < 2) { return 1e9f; }
+    const double variance = luminance_m2 / (n_samples - 1);
+    const double standard_error = glm::sqrt(variance / n_samples);
+    return standard_error / (eps + luminance_mean);
+  }
+};
+
+// adaptive sampling
+// every pixel first gets min_samples, then only pixels whose relative error
+// is above target_error get samples_per_round more samples in each round.
+// rendering ends when all pixels converge, reach max_samples, or time budget
+// is used up.
+class AdaptiveRendering
+{
+ public:
+  // target_error: relative standard error to stop sampling pixel
+  // time_budget: time limit in seconds, 0 means no limit
+  AdaptiveRendering(uint32_t min_samples, uint32_t max_samples,
+                    uint32_t samples_per_round, float target_error,
+                    float time_budget = 0.0f)
+      : m_min_samples(min_samples),
+        m_max_samples(max_samples),
+        m_samples_per_round(samples_per_round),
+        m_target_error(target_error),
+        m_time_budget(time_budget)
+  {
+  }
+
+  // render image and set mean radiance of each pixel to image
+  template <typename SamplerT>
+  void render(const Camera& camera, const Integrator& integrator,
+              const Intersector& intersector, const Sky& sky,
+              const SamplerT& sampler, Image& image)
+  {
+    const int width = image.getWidth();
+    const int height = image.getHeight();
+    m_statistics.assign(width * height, PixelStatistics());
+
+    // all pixels are active at first round
+    std::vector<uint32_t> active(width * height);
+    for (int p = 0; p < active.size(); ++p) { active[p] = p; }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int round = 0; !active.empty(); ++round) {
+      const uint32_t n_samples =
+          round == 0 ? m_min_samples : m_samples_per_round;
+
+      SamplerT sampler_private = sampler;
+#pragma omp parallel for schedule(dynamic, 16) firstprivate(sampler_private)
+      for (int q = 0; q < active.size(); ++q) {
+        const uint32_t pixel = active[q];
+        const int i = pixel % width;
+        const int j = pixel / width;
+        PixelStatistics& statistics = m_statistics[pixel];
+
+        const uint32_t n_end =
+            glm::min(statistics.n_samples + n_samples, m_max_samples);
+        for (uint32_t k = statistics.n_samples; k < n_end; ++k) {
+          sampler_private.startPixelSample(pixel, k);
+
+          const glm::vec2 u_pixel = sampler_private.next_2d();
+          glm::vec2 ndc =
+              glm::vec2((2.0f * (i + u_pixel.x) - width) / height,
+                        (2.0f * (j + u_pixel.y) - height) / height);
+          ndc.y *= -1.0f;
+
+          // sample ray from camera
+          const Ray ray = camera.sampleRay(ndc, sampler_private.next_2d());
+
+          // evaluate incoming radiance
+          glm::vec3 radiance =
+              integrator.integrate(ray, intersector, sky, sampler_private);
+
+          // count invalid sample as black to keep sample index in sync
+          if (isinf(radiance) || isnan(radiance)) {
+            radiance = glm::vec3(0.0f);
+          }
+          statistics.add(radiance);
+        }
+      }
+
+      // keep pixels which are not converged yet
+      std::vector<uint32_t> next_active;
+      for (const uint32_t pixel : active) {
+        const PixelStatistics& statistics = m_statistics[pixel];
+        if (statistics.n_samples < m_max_samples &&
+            statistics.relativeError(ERROR_EPS) > m_target_error) {
+          next_active.push_back(pixel);
+        }
+      }
+      active.swap(next_active);
+
+      const float elapsed = std::chrono::duration<float>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+      spdlog::info("[AdaptiveRendering] round {}: {} active pixels, {:.2f}s",
+                   round, active.size(), elapsed);
+      if (m_time_budget > 0.0f && elapsed > m_time_budget) {
+        spdlog::info("[AdaptiveRendering] time budget is used up");
+        break;
+      }
+    }
+
+    // count samples actually taken, which are clamped by max_samples
+    uint64_t n_total_samples = 0;
+    for (int p = 0; p < m_statistics.size(); ++p) {
+      image.setPixel(p % width, p / width, m_statistics[p].mean);
+      n_total_samples += m_statistics[p].n_samples;
+    }
+
+    spdlog::info("[AdaptiveRendering] average samples per pixel: {:.2f}",
+                 static_cast<double>(n_total_samples) / (width * height));
+  }
+
+  // number of samples taken at each pixel, available after render
+  uint32_t getSampleCount(int pixel) const
+  {
+    return m_statistics[pixel].n_samples;
+  }
+
+ private:
+  // added to mean luminance when computing relative error
+  static constexpr float ERROR_EPS = 1e-2f;
+
+  uint32_t m_min_samples;        // number of samples at first round
+  uint32_t m_max_samples;        // maximum number of samples per pixel
+  uint32_t m_samples_per_round;  // number of samples per round
+  float m_target_error;          // relative error to stop sampling pixel
+  float m_time_budget;           // time limit in seconds
+
+  std::vector<PixelStatistics> m_statistics;  // statistics of each pixel
+};
\ No newline at end of file
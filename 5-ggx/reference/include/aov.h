@@ -0,0 +1,289 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core.h"
+#include "glm/glm.hpp"
+#include "image.h"
+#include "intersector.h"
+#include "primitive.h"
+#include "sky.h"
+
+// arbitrary output variable(AOV)
+// all of them are features of first hit of camera ray except sample count
+enum class AOV {
+  ALBEDO,        // base color(RGB)
+  NORMAL,        // normal(XYZ), 0 for sky
+  DEPTH,         // distance, 0 for sky
+  PRIMITIVE_ID,  // index of primitive in intersector, -1 for sky
+  MATERIAL_ID,   // index of material in scene, -1 for sky
+  SAMPLE_COUNT,  // number of samples of pixel
+  BVH_COST,      // number of BVH nodes visited
+};
+
+// number of AOVs
+constexpr int N_AOVS = 7;
+
+// name of AOV
+inline const char* aov_name(AOV aov)
+{
+  constexpr const char* NAMES[N_AOVS] = {
+      "albedo", "normal", "depth", "primitive_id", "material_id",
+      "sample_count", "bvh_cost"};
+  return NAMES[static_cast<int>(aov)];
+}
+
+// parse name of AOV
+inline AOV parse_aov(const std::string& name)
+{
+  for (int k = 0; k < N_AOVS; ++k) {
+    if (name == aov_name(static_cast<AOV>(k))) { return static_cast<AOV>(k); }
+  }
+  throw std::runtime_error("unknown AOV " + name);
+}
+
+// number of channels of AOV
+inline int aov_n_channels(AOV aov)
+{
+  return (aov == AOV::ALBEDO || aov == AOV::NORMAL) ? 3 : 1;
+}
+
+// true if AOV is integer ID
+inline bool aov_is_id(AOV aov)
+{
+  return aov == AOV::PRIMITIVE_ID || aov == AOV::MATERIAL_ID;
+}
+
+// bit of AOV in mask of AOVs
+inline uint32_t aov_bit(AOV aov) { return 1u << static_cast<int>(aov); }
+
+// AOVs of one camera sample
+// only AOVs in mask are set by integrator, so that AOVs which aren't
+// requested cost nothing
+struct AOVSample {
+  uint32_t mask = 0;  // requested AOVs
+
+  glm::vec3 albedo = glm::vec3(0.0f);
+  glm::vec3 normal = glm::vec3(0.0f);
+  float depth = 0.0f;
+  int32_t primitive_id = -1;
+  int32_t material_id = -1;
+  float bvh_cost = 0.0f;
+
+  AOVSample(uint32_t mask_) : mask(mask_) {}
+
+  // true if aov is requested
+  bool has(AOV aov) const { return (mask & aov_bit(aov)) != 0; }
+
+  // find first intersection of camera ray
+  // visited bvh nodes are counted only if bvh cost is requested
+  bool intersectFirstHit(const Ray& ray, const Intersector& intersector,
+                         IntersectInfo& info) const
+  {
+    if (!has(AOV::BVH_COST)) { return intersector.intersect(ray, info); }
+    info.bvh_depth = 0;
+    return intersector.intersectCountingNodes(ray, info);
+  }
+
+  // set AOVs from first intersection of camera ray
+  // hit: result of intersection, info is used only for bvh cost if false
+  void setFirstHit(const Ray& ray, bool hit, const IntersectInfo& info,
+                   const Intersector& intersector, const Sky& sky)
+  {
+    if (has(AOV::BVH_COST)) { bvh_cost = info.bvh_depth; }
+
+    if (!hit) {
+      // sky is treated as surface of its radiance
+      if (has(AOV::ALBEDO)) {
+        albedo = glm::clamp(sky.evaluate(ray), 0.0f, 1.0f);
+      }
+      return;
+    }
+
+    const Material& material = *info.primitive->material;
+    if (has(AOV::ALBEDO)) {
+      if (info.primitive->has_emission()) {
+        albedo = glm::clamp(material.emission_color, 0.0f, 1.0f);
+      } else if (material.base_color_tex != nullptr) {
+        albedo = glm::vec3(material.base_color_tex->fetch(info.texcoord));
+      } else {
+        albedo = material.base_color;
+      }
+    }
+    if (has(AOV::NORMAL)) { normal = info.normal; }
+    if (has(AOV::DEPTH)) { depth = info.t; }
+    if (has(AOV::PRIMITIVE_ID)) {
+      primitive_id = intersector.getPrimitiveIndex(info.primitive);
+    }
+    if (has(AOV::MATERIAL_ID)) { material_id = material.id; }
+  }
+};
+
+// per pixel AOVs of image
+// only registered AOVs have storage, and each channel is stored in its own
+// plane, so that filters can process channels with vectorized loops.
+// AOVs are mean of samples of pixel except IDs, which keep last sample since
+// mean of IDs is meaningless. IDs are stored as int32, since float can't
+// represent IDs larger than 2^24 exactly.
+class AOVBuffer
+{
+ public:
+  // aovs: AOVs to register
+  AOVBuffer(int width, int height, const std::vector<AOV>& aovs)
+      : m_width(width), m_height(height), m_sample_counts(width * height, 0)
+  {
+    for (const AOV aov : aovs) {
+      const int k = static_cast<int>(aov);
+      if (m_mask & aov_bit(aov)) { continue; }
+      m_mask |= aov_bit(aov);
+      if (aov_is_id(aov)) {
+        m_ids[k].resize(width * height, -1);
+      } else if (aov != AOV::SAMPLE_COUNT) {
+        m_channels[k].resize(aov_n_channels(aov) * width * height, 0.0f);
+      }
+    }
+  }
+
+  // get width of image
+  int getWidth() const { return m_width; }
+
+  // get height of image
+  int getHeight() const { return m_height; }
+
+  // get mask of registered AOVs
+  uint32_t getMask() const { return m_mask; }
+
+  // true if aov is registered
+  bool has(AOV aov) const { return (m_mask & aov_bit(aov)) != 0; }
+
+  // get plane of channel c of aov, nullptr if it isn't registered or is ID
+  const float* getChannel(AOV aov, int c = 0) const
+  {
+    if (!has(aov) || aov_is_id(aov)) { return nullptr; }
+    if (aov == AOV::SAMPLE_COUNT) { return m_sample_counts.data(); }
+    return m_channels[static_cast<int>(aov)].data() + c * m_width * m_height;
+  }
+
+  // get plane of ID aov, nullptr if it isn't registered or isn't ID
+  const int32_t* getIds(AOV aov) const
+  {
+    if (!has(aov) || !aov_is_id(aov)) { return nullptr; }
+    return m_ids[static_cast<int>(aov)].data();
+  }
+
+  // add AOVs of sample to (i, j)
+  // pixels are independent, so that disjoint tiles can be added in parallel
+  void addSample(int i, int j, const AOVSample& sample)
+  {
+    const int idx = i + m_width * j;
+    m_sample_counts[idx] += 1.0f;
+
+    if (has(AOV::ALBEDO)) { add(AOV::ALBEDO, idx, sample.albedo); }
+    if (has(AOV::NORMAL)) { add(AOV::NORMAL, idx, sample.normal); }
+    if (has(AOV::DEPTH)) { channel(AOV::DEPTH, 0)[idx] += sample.depth; }
+    if (has(AOV::PRIMITIVE_ID)) {
+      m_ids[static_cast<int>(AOV::PRIMITIVE_ID)][idx] = sample.primitive_id;
+    }
+    if (has(AOV::MATERIAL_ID)) {
+      m_ids[static_cast<int>(AOV::MATERIAL_ID)][idx] = sample.material_id;
+    }
+    if (has(AOV::BVH_COST)) {
+      channel(AOV::BVH_COST, 0)[idx] += sample.bvh_cost;
+    }
+  }
+
+  // divide sums by sample count of each pixel
+  // this is called once after all samples are added
+  void resolve()
+  {
+    const int n = m_width * m_height;
+    for (const AOV aov : {AOV::ALBEDO, AOV::NORMAL, AOV::DEPTH,
+                          AOV::BVH_COST}) {
+      if (!has(aov)) { continue; }
+      for (int c = 0; c < aov_n_channels(aov); ++c) {
+        float* plane = channel(aov, c);
+        const float* counts = m_sample_counts.data();
+#pragma omp parallel for simd
+        for (int idx = 0; idx < n; ++idx) {
+          plane[idx] /= glm::max(counts[idx], 1.0f);
+        }
+      }
+    }
+  }
+
+ private:
+  int m_width;                            // width of image
+  int m_height;                           // height of image
+  uint32_t m_mask = 0;                    // registered AOVs
+  std::vector<float> m_channels[N_AOVS];  // planes of each AOV
+  std::vector<int32_t> m_ids[N_AOVS];     // planes of ID AOVs
+  std::vector<float> m_sample_counts;     // number of samples of pixel
+
+  float* channel(AOV aov, int c)
+  {
+    return m_channels[static_cast<int>(aov)].data() + c * m_width * m_height;
+  }
+
+  void add(AOV aov, int idx, const glm::vec3& v)
+  {
+    for (int c = 0; c < 3; ++c) { channel(aov, c)[idx] += v[c]; }
+  }
+};
+
+// convert aov into image for inspection
+// albedo is copied, normal is mapped to [0, 1], IDs are colored by hash, and
+// depth, sample count and bvh cost are normalized by their maximum
+inline void visualize_aov(const AOVBuffer& buffer, AOV aov, Image& image)
+{
+  const int width = buffer.getWidth();
+  const int height = buffer.getHeight();
+  const int n = width * height;
+  if (!buffer.has(aov)) {
+    throw std::runtime_error(std::string("AOV isn't registered: ") +
+                             aov_name(aov));
+  }
+
+  // maximum used for normalization
+  const bool normalized = aov == AOV::DEPTH || aov == AOV::SAMPLE_COUNT ||
+                          aov == AOV::BVH_COST;
+  float max_value = 0.0f;
+  if (normalized) {
+    const float* plane = buffer.getChannel(aov);
+    for (int idx = 0; idx < n; ++idx) {
+      max_value = glm::max(max_value, plane[idx]);
+    }
+  }
+  // counts below 1 aren't amplified, depth is scaled into [0, 1]
+  const float normalizer = aov == AOV::DEPTH
+                               ? (max_value > 0.0f ? max_value : 1.0f)
+                               : glm::max(max_value, 1.0f);
+
+#pragma omp parallel for
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      const int idx = i + width * j;
+      glm::vec3 color(0.0f);
+      if (aov_is_id(aov)) {
+        const int32_t id = buffer.getIds(aov)[idx];
+        uint32_t h = static_cast<uint32_t>(id + 1) * 2654435761u;
+        h ^= h >> 15;
+        color = id < 0 ? glm::vec3(0.0f)
+                       : glm::vec3((h & 0xff) / 255.0f,
+                                   ((h >> 8) & 0xff) / 255.0f,
+                                   ((h >> 16) & 0xff) / 255.0f);
+      } else if (aov_n_channels(aov) == 3) {
+        color = glm::vec3(buffer.getChannel(aov, 0)[idx],
+                          buffer.getChannel(aov, 1)[idx],
+                          buffer.getChannel(aov, 2)[idx]);
+        if (aov == AOV::NORMAL) { color = 0.5f * (color + 1.0f); }
+      } else {
+        color = glm::vec3(buffer.getChannel(aov)[idx]);
+      }
+
+      if (normalized) { color /= normalizer; }
+      image.setPixel(i, j, color);
+    }
+  }
+}
\ No newline at end of file
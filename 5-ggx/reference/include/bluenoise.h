@@ -0,0 +1,207 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "sampler.h"
+#include "spdlog/spdlog.h"
+
+// tileable blue noise texture generated by void-and-cluster method
+// Ulichney, R. (1993). Void-and-cluster method for dither array generation.
+class BlueNoiseTile
+{
+ public:
+  // size: width and height of tile(must be power of 2)
+  // seed: seed of initial binary pattern
+  BlueNoiseTile(int size = 64, uint64_t seed = 0) : m_size(size)
+  {
+    if (size <= 0 || (size & (size - 1)) != 0) {
+      throw std::runtime_error("blue noise tile size must be power of 2");
+    }
+
+    generate(seed);
+
+    spdlog::info("[BlueNoiseTile] size: {}x{}", m_size, m_size);
+  }
+
+  // size of tile
+  int size() const { return m_size; }
+
+  // fetch blue noise value in [0, 1) at (i, j), wrapped around tile
+  float fetch(int i, int j) const
+  {
+    const int mask = m_size - 1;
+    return m_values[(i & mask) + m_size * (j & mask)];
+  }
+
+ private:
+  int m_size;                   // width and height of tile
+  std::vector<float> m_values;  // (rank + 0.5) / number of pixels
+
+  void generate(uint64_t seed)
+  {
+    const int n_pixels = m_size * m_size;
+    const int mask = m_size - 1;
+
+    // toroidal gaussian kernel
+    const float sigma = 1.5f;
+    std::vector<float> kernel(n_pixels);
+    for (int j = 0; j < m_size; ++j) {
+      for (int i = 0; i < m_size; ++i) {
+        const int dx = glm::min(i, m_size - i);
+        const int dy = glm::min(j, m_size - j);
+        kernel[i + m_size * j] =
+            std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+      }
+    }
+
+    std::vector<uint8_t> pattern(n_pixels, 0);
+    std::vector<float> energy(n_pixels, 0.0f);
+
+    // add(sign = 1) or remove(sign = -1) point at p and update energy
+    const auto update = [&](int p, float sign) {
+      pattern[p] = sign > 0.0f ? 1 : 0;
+      const int px = p % m_size;
+      const int py = p / m_size;
+      for (int j = 0; j < m_size; ++j) {
+        for (int i = 0; i < m_size; ++i) {
+          const int k = ((i - px) & mask) + m_size * ((j - py) & mask);
+          energy[i + m_size * j] += sign * kernel[k];
+        }
+      }
+    };
+
+    // find point with maximum energy among 1s(tightest cluster)
+    const auto tightest_cluster = [&]() {
+      int ret = -1;
+      for (int p = 0; p < n_pixels; ++p) {
+        if (pattern[p] && (ret < 0 || energy[p] > energy[ret])) { ret = p; }
+      }
+      return ret;
+    };
+
+    // find point with minimum energy among 0s(largest void)
+    const auto largest_void = [&]() {
+      int ret = -1;
+      for (int p = 0; p < n_pixels; ++p) {
+        if (!pattern[p] && (ret < 0 || energy[p] < energy[ret])) { ret = p; }
+      }
+      return ret;
+    };
+
+    // initial binary pattern
+    RandomSampler sampler(seed);
+    const int n_initial = glm::max(n_pixels / 10, 1);
+    int n_ones = 0;
+    while (n_ones < n_initial) {
+      const int p = glm::min(static_cast<int>(sampler.next_1d() * n_pixels),
+                             n_pixels - 1);
+      if (!pattern[p]) {
+        update(p, 1.0f);
+        n_ones++;
+      }
+    }
+
+    // relax initial pattern by moving tightest cluster to largest void
+    for (int iter = 0; iter < n_pixels; ++iter) {
+      const int cluster = tightest_cluster();
+      update(cluster, -1.0f);
+      const int void_ = largest_void();
+      update(void_, 1.0f);
+      if (void_ == cluster) { break; }
+    }
+    const std::vector<uint8_t> prototype = pattern;
+    const std::vector<float> prototype_energy = energy;
+
+    std::vector<int> ranks(n_pixels, 0);
+
+    // phase 1: rank points of prototype by removing tightest cluster
+    for (int rank = n_ones - 1; rank >= 0; --rank) {
+      const int cluster = tightest_cluster();
+      update(cluster, -1.0f);
+      ranks[cluster] = rank;
+    }
+
+    // phase 2, 3: rank remaining points by filling largest void
+    // NOTE: tightest cluster of 0s is equal to largest void of 1s, since
+    // kernel sum is constant
+    pattern = prototype;
+    energy = prototype_energy;
+    for (int rank = n_ones; rank < n_pixels; ++rank) {
+      const int void_ = largest_void();
+      update(void_, 1.0f);
+      ranks[void_] = rank;
+    }
+
+    m_values.resize(n_pixels);
+    for (int p = 0; p < n_pixels; ++p) {
+      m_values[p] = (ranks[p] + 0.5f) / n_pixels;
+    }
+  }
+};
+
+// sampler which distributes error as blue noise in screen space
+// all pixels share one Owen-scrambled sobol sequence, and each pixel scrambles
+// it by blue noise values(XOR digital shift per dimension).
+// since neighboring pixels get dissimilar shifts, the error at low sample
+// count looks like blue noise instead of white noise.
+// Georgiev, I., & Fajardo, M. (2016). Blue-noise dithered sampling.
+// Heitz, E., & Belcour, L. (2019). Distributing Monte Carlo errors as a blue
+// noise in screen space by permuting pixel seeds between frames.
+class BlueNoiseSampler : public Sampler
+{
+ public:
+  // tile: blue noise tile(must outlive the sampler)
+  // width: image width, used to recover pixel position from pixel index
+  BlueNoiseSampler(uint64_t seed, const BlueNoiseTile* tile, int width)
+      : Sampler(seed), m_sobol(seed), m_tile(tile), m_width(width)
+  {
+  }
+
+  void startPixelSample(uint32_t pixel_index, uint32_t sample_index) override
+  {
+    // every pixel uses same sequence
+    m_sobol.startPixelSample(0, sample_index);
+    m_i = pixel_index % m_width;
+    m_j = pixel_index / m_width;
+    m_dimension = 0;
+  }
+
+  float next_1d() override
+  {
+    const uint32_t dimension = m_dimension++;
+    return shift(m_sobol.next_1d(), dimension, 0);
+  }
+
+  glm::vec2 next_2d() override
+  {
+    const uint32_t dimension = m_dimension++;
+    const glm::vec2 u = m_sobol.next_2d();
+    return glm::vec2(shift(u.x, dimension, 0), shift(u.y, dimension, 1));
+  }
+
+ private:
+  SobolSampler m_sobol;         // shared sequence
+  const BlueNoiseTile* m_tile;  // blue noise tile
+  int m_width;                  // image width
+
+  int m_i = 0;               // current pixel position
+  int m_j = 0;               // current pixel position
+  uint32_t m_dimension = 0;  // current dimension
+
+  // shift u by blue noise value with XOR, which keeps stratification of sobol
+  // sequence unlike toroidal shift
+  // each dimension fetches tile with different offset to decorrelate
+  // dimensions
+  float shift(float u, uint32_t dimension, uint32_t component) const
+  {
+    const uint32_t h = hash_combine(
+        hash_combine(static_cast<uint32_t>(m_seed), dimension), component);
+    const float offset = m_tile->fetch(m_i + (h & 0xffff), m_j + (h >> 16));
+    const uint32_t a = static_cast<uint32_t>(u * (1u << 24));
+    const uint32_t b = static_cast<uint32_t>(offset * (1u << 24));
+    return (a ^ b) * (1.0f / (1u << 24));
+  }
+};
\ No newline at end of file
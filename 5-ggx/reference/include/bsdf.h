@@ -6,20 +6,6 @@
 #include "primitive.h"
 #include "sampler.h"
 
-// convert reflectivity, edge tint to complex IOR
-inline void artist_friendly_metallic_fresnel(const glm::vec3& reflectivity,
-                                             const glm::vec3& edge_tint,
-                                             glm::vec3& n, glm::vec3& k)
-{
-  // https://jcgt.org/published/0003/04/03/
-  const glm::vec3 r_sqrt = glm::sqrt(reflectivity);
-  n = edge_tint * (1.0f - reflectivity) / (1.0f + reflectivity) +
-      (1.0f - edge_tint) * (1.0f + r_sqrt) / (1.0f - r_sqrt);
-  const glm::vec3 t1 = n + 1.0f;
-  const glm::vec3 t2 = n - 1.0f;
-  k = glm::sqrt((reflectivity * (t1 * t1) - t2 * t2) / (1.0f - reflectivity));
-}
-
 class BSDF
 {
  public:
@@ -33,6 +19,17 @@ class BSDF
   virtual glm::vec3 sampleDirection(const glm::vec2& u, float v,
                                     const glm::vec3& wo, glm::vec3& f,
                                     float& pdf) const = 0;
+
+  // evaluate BSDF value
+  // wo: view direction in tangent space
+  // wi: incident direction in tangent space
+  virtual glm::vec3 evaluate(const glm::vec3& wo,
+                             const glm::vec3& wi) const = 0;
+
+  // evaluate pdf of sampling wi by sampleDirection
+  // wo: view direction in tangent space
+  // wi: incident direction in tangent space
+  virtual float pdf(const glm::vec3& wo, const glm::vec3& wi) const = 0;
 };
 
 // Lambert Diffuse BRDF only
@@ -57,6 +54,16 @@ class LambertOnly : public BSDF
     return m_lambert.sampleDirection(u, wo, f, pdf);
   }
 
+  glm::vec3 evaluate(const glm::vec3& wo, const glm::vec3& wi) const override
+  {
+    return m_lambert.evaluate(wo, wi);
+  }
+
+  float pdf(const glm::vec3& wo, const glm::vec3& wi) const override
+  {
+    return m_lambert.pdf(wo, wi);
+  }
+
  private:
   Lambert m_lambert;
 };
@@ -80,31 +87,31 @@ class DiffuseSpecularMetal : public BSDF
           glm::vec3(material.specular_color_tex->fetch(info.texcoord));
     }
 
-    float specular = glm::clamp(material.specular, 0.0f, 1.0f);
     float specular_roughness =
         glm::clamp(material.specular_roughness, 0.01f, 1.0f);
     float specular_anisotropy = 0.0f;
 
-    float metalness = glm::clamp(material.metalness, 0.0f, 1.0f);
-
     m_lambert = Lambert(base_color);
     m_specular = MicrofacetReflectionDielectric(1.5f, specular_roughness,
                                                 specular_anisotropy);
 
-    glm::vec3 n, k;
-    artist_friendly_metallic_fresnel(
-        glm::clamp(base_color, glm::vec3(0.01f), glm::vec3(0.99f)),
-        glm::clamp(specular_color, glm::vec3(0.01), glm::vec3(0.99f)), n, k);
+    // use precomputed complex IOR unless it depends on texture
+    glm::vec3 n = material.metal_n;
+    glm::vec3 k = material.metal_k;
+    const bool textured = material.base_color_tex != nullptr ||
+                          material.specular_color_tex != nullptr;
+    if (textured && material.bxdf_sampling_weights[2] > 0.0f) {
+      artist_friendly_metallic_fresnel(base_color, specular_color, n, k);
+    }
     m_metal = MicrofacetReflectionConductor(n, k, specular_roughness,
                                             specular_anisotropy);
 
-    m_bxdf_weights[0] = glm::vec3(1.0f - metalness);
-    m_bxdf_weights[1] = specular * (1.0f - metalness) * specular_color;
-    m_bxdf_weights[2] = glm::vec3(metalness);
+    m_bxdf_weights[0] = glm::vec3(material.bxdf_sampling_weights[0]);
+    m_bxdf_weights[1] = material.bxdf_sampling_weights[1] * specular_color;
+    m_bxdf_weights[2] = glm::vec3(material.bxdf_sampling_weights[2]);
 
-    float bxdf_sampling_weight[] = {(1.0f - metalness),
-                                    specular * (1.0f - metalness), metalness};
-    m_distribution = DiscreteDistribution1D(bxdf_sampling_weight, 3);
+    m_distribution =
+        FixedDiscreteDistribution1D<3>(material.bxdf_sampling_weights);
   }
 
   glm::vec3 sampleDirection(const glm::vec2& u, float v, const glm::vec3& wo,
@@ -141,6 +148,21 @@ class DiffuseSpecularMetal : public BSDF
     return glm::vec3(0.0f);
   }
 
+  glm::vec3 evaluate(const glm::vec3& wo, const glm::vec3& wi) const override
+  {
+    return m_bxdf_weights[0] * m_lambert.evaluate(wo, wi) +
+           m_bxdf_weights[1] * m_specular.evaluate(wo, wi) +
+           m_bxdf_weights[2] * m_metal.evaluate(wo, wi);
+  }
+
+  float pdf(const glm::vec3& wo, const glm::vec3& wi) const override
+  {
+    // mixture of BxDF pdfs weighted by selection probability
+    return m_distribution.pmf(0) * m_lambert.pdf(wo, wi) +
+           m_distribution.pmf(1) * m_specular.pdf(wo, wi) +
+           m_distribution.pmf(2) * m_metal.pdf(wo, wi);
+  }
+
  private:
   glm::vec3 m_bxdf_weights[3];
 
@@ -148,5 +170,5 @@ class DiffuseSpecularMetal : public BSDF
   MicrofacetReflectionDielectric m_specular;
   MicrofacetReflectionConductor m_metal;
 
-  DiscreteDistribution1D m_distribution;
+  FixedDiscreteDistribution1D<3> m_distribution;
 };
\ No newline at end of file
@@ -119,6 +119,17 @@ class BxDF
   // return: sampled direction in tangent space
   virtual glm::vec3 sampleDirection(const glm::vec2& u, const glm::vec3& wo,
                                     glm::vec3& f, float& pdf) const = 0;
+
+  // evaluate BxDF value
+  // wo: view direction in tangent space
+  // wi: incident direction in tangent space
+  virtual glm::vec3 evaluate(const glm::vec3& wo,
+                             const glm::vec3& wi) const = 0;
+
+  // evaluate pdf of sampling wi
+  // wo: view direction in tangent space
+  // wi: incident direction in tangent space
+  virtual float pdf(const glm::vec3& wo, const glm::vec3& wi) const = 0;
 };
 
 // Lambert Diffuse BRDF
@@ -137,6 +148,18 @@ class Lambert : public BxDF
     return wi;
   }
 
+  glm::vec3 evaluate(const glm::vec3& wo, const glm::vec3& wi) const override
+  {
+    if (cos_theta(wi) <= 0.0f) { return glm::vec3(0.0f); }
+    return m_albedo / M_PIf;
+  }
+
+  float pdf(const glm::vec3& wo, const glm::vec3& wi) const override
+  {
+    if (cos_theta(wi) <= 0.0f) { return 0.0f; }
+    return abs_cos_theta(wi) / M_PIf;
+  }
+
  private:
   glm::vec3 m_albedo;  // diffuse albedo
 };
@@ -227,6 +250,28 @@ class MicrofacetReflectionDielectric : public BxDF
     return wi;
   }
 
+  glm::vec3 evaluate(const glm::vec3& wo, const glm::vec3& wi) const override
+  {
+    if (cos_theta(wo) <= 0.0f || cos_theta(wi) <= 0.0f) {
+      return glm::vec3(0.0f);
+    }
+
+    const glm::vec3 wh = glm::normalize(wo + wi);
+    const float fr = m_fresnel.evaluate(glm::abs(glm::dot(wo, wh)));
+    const float d = ggx_ndf(wh, m_alpha);
+    const float g2 = ggx_g2(wo, wi, m_alpha);
+    return glm::vec3(0.25f * (fr * d * g2) /
+                     (abs_cos_theta(wo) * abs_cos_theta(wi)));
+  }
+
+  float pdf(const glm::vec3& wo, const glm::vec3& wi) const override
+  {
+    if (cos_theta(wo) <= 0.0f || cos_theta(wi) <= 0.0f) { return 0.0f; }
+
+    const glm::vec3 wh = glm::normalize(wo + wi);
+    return sample_ggx_vndf_pdf(wo, wh, m_alpha);
+  }
+
  private:
   FresnelDielectric m_fresnel;
   glm::vec2 m_alpha;
@@ -265,6 +310,27 @@ class MicrofacetReflectionConductor : public BxDF
     return wi;
   }
 
+  glm::vec3 evaluate(const glm::vec3& wo, const glm::vec3& wi) const override
+  {
+    if (cos_theta(wo) <= 0.0f || cos_theta(wi) <= 0.0f) {
+      return glm::vec3(0.0f);
+    }
+
+    const glm::vec3 wh = glm::normalize(wo + wi);
+    const glm::vec3 fr = m_fresnel.evaluate(glm::abs(glm::dot(wo, wh)));
+    const float d = ggx_ndf(wh, m_alpha);
+    const float g2 = ggx_g2(wo, wi, m_alpha);
+    return 0.25f * (fr * d * g2) / (abs_cos_theta(wo) * abs_cos_theta(wi));
+  }
+
+  float pdf(const glm::vec3& wo, const glm::vec3& wi) const override
+  {
+    if (cos_theta(wo) <= 0.0f || cos_theta(wi) <= 0.0f) { return 0.0f; }
+
+    const glm::vec3 wh = glm::normalize(wo + wi);
+    return sample_ggx_vndf_pdf(wo, wh, m_alpha);
+  }
+
  private:
   FresnelConductor m_fresnel;
   glm::vec2 m_alpha;
@@ -0,0 +1,141 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+
+// render state saved in checkpoint file
+// sampler state is restored from its seed, since sample sequence depends only
+// on (seed, pixel_index, sample_index)
+struct Checkpoint {
+  uint64_t settings_hash = 0;            // hash of render settings
+  uint32_t width = 0;                    // width of image
+  uint32_t height = 0;                   // height of image
+  uint64_t sampler_seed = 0;             // seed of sampler
+  uint32_t samples_per_pass = 0;         // number of samples in one pass
+  uint32_t n_passes = 0;                 // number of finished passes
+  uint32_t n_half_samples[2] = {0, 0};   // samples in each half buffer
+  float elapsed = 0.0f;                  // elapsed time in seconds
+  std::vector<double> half_buffers[2];   // sum of radiance(RGB)
+  std::vector<uint32_t> sample_counts;   // number of samples of each pixel
+};
+
+// magic number and version of checkpoint file
+constexpr char CHECKPOINT_MAGIC[4] = {'P', 'T', 'C', 'K'};
+constexpr uint32_t CHECKPOINT_VERSION = 3;
+
+// hash of render settings which the result depends on, e.g. scene path,
+// integrator, sampler type and max depth(64bit FNV-1a)
+// resuming is refused if it doesn't match
+inline uint64_t settings_hash(const std::string& settings)
+{
+  uint64_t h = 0xcbf29ce484222325;
+  for (const char c : settings) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 0x100000001b3;
+  }
+  return h;
+}
+
+// write checkpoint to binary file
+// file is written to temporary file first and renamed, so that a killed
+// process never leaves broken checkpoint
+inline void write_checkpoint(const std::filesystem::path& filepath,
+                             const Checkpoint& checkpoint)
+{
+  const std::filesystem::path tmp_filepath = filepath.string() + ".tmp";
+  {
+    std::ofstream file(tmp_filepath, std::ios::binary);
+    if (!file.is_open()) {
+      throw std::runtime_error("failed to open " + tmp_filepath.string());
+    }
+
+    const auto write = [&](const void* data, size_t size) {
+      file.write(reinterpret_cast<const char*>(data), size);
+    };
+    write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    write(&CHECKPOINT_VERSION, sizeof(CHECKPOINT_VERSION));
+    write(&checkpoint.settings_hash, sizeof(checkpoint.settings_hash));
+    write(&checkpoint.width, sizeof(checkpoint.width));
+    write(&checkpoint.height, sizeof(checkpoint.height));
+    write(&checkpoint.sampler_seed, sizeof(checkpoint.sampler_seed));
+    write(&checkpoint.samples_per_pass, sizeof(checkpoint.samples_per_pass));
+    write(&checkpoint.n_passes, sizeof(checkpoint.n_passes));
+    write(checkpoint.n_half_samples, sizeof(checkpoint.n_half_samples));
+    write(&checkpoint.elapsed, sizeof(checkpoint.elapsed));
+
+    const size_t n_pixels = checkpoint.width * checkpoint.height;
+    for (int k = 0; k < 2; ++k) {
+      write(checkpoint.half_buffers[k].data(), 3 * n_pixels * sizeof(double));
+    }
+    write(checkpoint.sample_counts.data(), n_pixels * sizeof(uint32_t));
+
+    if (!file) {
+      throw std::runtime_error("failed to write " + tmp_filepath.string());
+    }
+  }
+
+  std::filesystem::rename(tmp_filepath, filepath);
+}
+
+// read checkpoint from binary file
+// return: false if file doesn't exist
+inline bool read_checkpoint(const std::filesystem::path& filepath,
+                            Checkpoint& checkpoint)
+{
+  std::ifstream file(filepath, std::ios::binary);
+  if (!file.is_open()) { return false; }
+
+  const auto read = [&](void* data, size_t size) {
+    file.read(reinterpret_cast<char*>(data), size);
+    if (!file) {
+      throw std::runtime_error("broken checkpoint " + filepath.string());
+    }
+  };
+
+  char magic[4];
+  uint32_t version;
+  read(magic, sizeof(magic));
+  read(&version, sizeof(version));
+  if (std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 ||
+      version != CHECKPOINT_VERSION) {
+    throw std::runtime_error("unsupported checkpoint " + filepath.string());
+  }
+
+  read(&checkpoint.settings_hash, sizeof(checkpoint.settings_hash));
+  read(&checkpoint.width, sizeof(checkpoint.width));
+  read(&checkpoint.height, sizeof(checkpoint.height));
+  read(&checkpoint.sampler_seed, sizeof(checkpoint.sampler_seed));
+  read(&checkpoint.samples_per_pass, sizeof(checkpoint.samples_per_pass));
+  read(&checkpoint.n_passes, sizeof(checkpoint.n_passes));
+  read(checkpoint.n_half_samples, sizeof(checkpoint.n_half_samples));
+  read(&checkpoint.elapsed, sizeof(checkpoint.elapsed));
+
+  const size_t n_pixels = checkpoint.width * checkpoint.height;
+  for (int k = 0; k < 2; ++k) {
+    checkpoint.half_buffers[k].resize(3 * n_pixels);
+    read(checkpoint.half_buffers[k].data(), 3 * n_pixels * sizeof(double));
+  }
+  checkpoint.sample_counts.resize(n_pixels);
+  read(checkpoint.sample_counts.data(), n_pixels * sizeof(uint32_t));
+
+  spdlog::info("[Checkpoint] loaded {}: {} passes", filepath.string(),
+               checkpoint.n_passes);
+
+  return true;
+}
+
+// remove checkpoint file and its temporary file
+inline void remove_checkpoint(const std::filesystem::path& filepath)
+{
+  std::error_code error;
+  std::filesystem::remove(filepath.string() + ".tmp", error);
+  if (std::filesystem::remove(filepath, error)) {
+    spdlog::info("[Checkpoint] removed {}", filepath.string());
+  }
+}
\ No newline at end of file
@@ -30,7 +30,7 @@ struct IntersectInfo {
   glm::vec2 texcoord = glm::vec2(0.0f);  // hit texcoord
   const Primitive* primitive = nullptr;  // hit primitive pointer
 
-  int bvh_depth = 0;  // bvh intersection count(for debugging purpose)
+  int bvh_depth = 0;  // visited bvh nodes, set by intersectCountingNodes
 };
 
 struct Material {
@@ -48,7 +48,19 @@ struct Material {
   float specular_roughness = 0.1f;  // specular roughness
   float metalness = 0.0f;           // metalness
 
+  int id = -1;  // index of material in scene
+
+  // constants derived from the parameters above(filled by precompute)
+  glm::vec3 metal_n = glm::vec3(1.0f);  // real part of metal IOR
+  glm::vec3 metal_k = glm::vec3(0.0f);  // imaginary part of metal IOR
+  // BxDF weights of diffuse, specular, metal
+  float bxdf_sampling_weights[3] = {1.0f, 0.0f, 0.0f};
+
   Material() {}
+
+  // precompute constants used when setting up BSDF
+  // must be called after the parameters are changed
+  void precompute();
 };
 
 // convert spherical coordinate to cartesian coordinate
@@ -104,6 +116,43 @@ inline glm::vec3 local_to_world(const glm::vec3& v, const glm::vec3& t,
                    v.x * t.z + v.y * n.z + v.z * b.z);
 }
 
+// convert reflectivity, edge tint to complex IOR
+// reflectivity, edge_tint are clamped to [0.01, 0.99]
+inline void artist_friendly_metallic_fresnel(const glm::vec3& reflectivity,
+                                             const glm::vec3& edge_tint,
+                                             glm::vec3& n, glm::vec3& k)
+{
+  // https://jcgt.org/published/0003/04/03/
+  const glm::vec3 r =
+      glm::clamp(reflectivity, glm::vec3(0.01f), glm::vec3(0.99f));
+  const glm::vec3 g = glm::clamp(edge_tint, glm::vec3(0.01f), glm::vec3(0.99f));
+  const glm::vec3 r_sqrt = glm::sqrt(r);
+  n = g * (1.0f - r) / (1.0f + r) +
+      (1.0f - g) * (1.0f + r_sqrt) / (1.0f - r_sqrt);
+  const glm::vec3 t1 = n + 1.0f;
+  const glm::vec3 t2 = n - 1.0f;
+  k = glm::sqrt((r * (t1 * t1) - t2 * t2) / (1.0f - r));
+}
+
+inline void Material::precompute()
+{
+  const float s = glm::clamp(specular, 0.0f, 1.0f);
+  const float m = glm::clamp(metalness, 0.0f, 1.0f);
+
+  bxdf_sampling_weights[0] = 1.0f - m;
+  bxdf_sampling_weights[1] = s * (1.0f - m);
+  bxdf_sampling_weights[2] = m;
+
+  artist_friendly_metallic_fresnel(base_color, specular_color, metal_n,
+                                   metal_k);
+}
+
+// return luminance of linear RGB(Rec.709)
+inline float luminance(const glm::vec3& rgb)
+{
+  return glm::dot(rgb, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
 // return true if v has inf
 inline bool isinf(const glm::vec3& v)
 {
@@ -0,0 +1,750 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// adler-32 checksum of zlib stream
+inline uint32_t adler32(const unsigned char* data, size_t size,
+                        uint32_t adler = 1)
+{
+  constexpr uint32_t BASE = 65521;
+  // largest n such that 255n(n+1)/2 + (n+1)(BASE-1) doesn't overflow
+  constexpr size_t NMAX = 5552;
+
+  uint32_t a = adler & 0xffff;
+  uint32_t b = adler >> 16;
+  while (size > 0) {
+    const size_t n = std::min(size, NMAX);
+    for (size_t k = 0; k < n; ++k) {
+      a += data[k];
+      b += a;
+    }
+    a %= BASE;
+    b %= BASE;
+    data += n;
+    size -= n;
+  }
+  return a | (b << 16);
+}
+
+// adler-32 of concatenation of two data from their adler-32
+// size2: size of second data
+inline uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t size2)
+{
+  constexpr uint32_t BASE = 65521;
+  const uint32_t rem = size2 % BASE;
+  uint32_t a = (adler1 & 0xffff) + (adler2 & 0xffff) + BASE - 1;
+  uint64_t b = static_cast<uint64_t>(rem) * (adler1 & 0xffff) % BASE;
+  b += (adler1 >> 16) + (adler2 >> 16) + BASE - rem;
+  a %= BASE;
+  b %= BASE;
+  return a | (static_cast<uint32_t>(b) << 16);
+}
+
+// base and number of extra bits of length symbols 257-285
+inline constexpr uint16_t LENGTH_BASE[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+inline constexpr uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                             1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                             4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// base and number of extra bits of distance symbols
+inline constexpr uint16_t DISTANCE_BASE[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+inline constexpr uint8_t DISTANCE_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// order of code length symbols in header of dynamic huffman block
+inline constexpr uint8_t CODE_LENGTH_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// length symbol(offset from 257) of match length 3-258
+inline int length_symbol(int length)
+{
+  static const std::array<uint8_t, 259> table = []() {
+    std::array<uint8_t, 259> t = {};
+    for (int l = 0; l < 29; ++l) {
+      const int end = l < 28 ? LENGTH_BASE[l + 1] : 259;
+      for (int n = LENGTH_BASE[l]; n < end; ++n) { t[n] = l; }
+    }
+    return t;
+  }();
+  return table[length];
+}
+
+// distance symbol of match distance 1-32768
+inline int distance_symbol(int distance)
+{
+  static const std::vector<uint8_t> table = []() {
+    std::vector<uint8_t> t(32769);
+    for (int d = 0; d < 30; ++d) {
+      const int end = d < 29 ? DISTANCE_BASE[d + 1] : 32769;
+      for (int n = DISTANCE_BASE[d]; n < end; ++n) { t[n] = d; }
+    }
+    return t;
+  }();
+  return table[distance];
+}
+
+// writer of deflate bit stream(LSB first)
+class BitWriter
+{
+ public:
+  BitWriter(std::vector<unsigned char>& out) : m_out(out) {}
+
+  // write lower n bits of value
+  void write(uint32_t value, int n)
+  {
+    m_bits |= value << m_n_bits;
+    m_n_bits += n;
+    while (m_n_bits >= 8) {
+      m_out.push_back(m_bits & 0xff);
+      m_bits >>= 8;
+      m_n_bits -= 8;
+    }
+  }
+
+  // pad with 0 to byte boundary
+  void align()
+  {
+    if (m_n_bits > 0) {
+      m_out.push_back(m_bits & 0xff);
+      m_bits = 0;
+      m_n_bits = 0;
+    }
+  }
+
+ private:
+  std::vector<unsigned char>& m_out;
+  uint32_t m_bits = 0;  // pending bits
+  int m_n_bits = 0;     // number of pending bits
+};
+
+// code lengths of huffman code of symbols, limited to max_length
+// symbols of zero frequency get length 0. at least two symbols get codes,
+// since some decoders reject code of one symbol. when code is too long,
+// frequencies are halved until it fits, which is simple and close to
+// optimal for deflate, whose limit is rarely hit.
+inline void huffman_code_lengths(const uint32_t* frequencies, int n_symbols,
+                                 int max_length, uint8_t* lengths)
+{
+  std::vector<uint32_t> f(frequencies, frequencies + n_symbols);
+  int n_used = 0;
+  for (int s = 0; s < n_symbols; ++s) { n_used += f[s] > 0; }
+  for (int s = 0; n_used < 2 && s < n_symbols; ++s) {
+    if (f[s] == 0) {
+      f[s] = 1;
+      n_used++;
+    }
+  }
+
+  std::vector<int> symbols;
+  for (int s = 0; s < n_symbols; ++s) {
+    if (f[s] > 0) { symbols.push_back(s); }
+  }
+  const int m = symbols.size();
+
+  std::vector<uint64_t> weights(2 * m - 1);
+  std::vector<int> parents(2 * m - 1);
+  std::vector<int> depths(2 * m - 1);
+  while (true) {
+    std::stable_sort(symbols.begin(), symbols.end(),
+                     [&](int a, int b) { return f[a] < f[b]; });
+    for (int k = 0; k < m; ++k) { weights[k] = f[symbols[k]]; }
+
+    // merge two lightest nodes. leaves are sorted and internal nodes are
+    // made in order of weight, so lightest one is at front of either queue
+    int leaf = 0;
+    int node = m;
+    const auto pop = [&](int end) {
+      if (leaf < m && (node >= end || weights[leaf] <= weights[node])) {
+        return leaf++;
+      }
+      return node++;
+    };
+    for (int k = m; k < 2 * m - 1; ++k) {
+      const int a = pop(k);
+      const int b = pop(k);
+      weights[k] = weights[a] + weights[b];
+      parents[a] = k;
+      parents[b] = k;
+    }
+
+    depths[2 * m - 2] = 0;
+    int max_depth = 0;
+    for (int k = 2 * m - 3; k >= 0; --k) {
+      depths[k] = depths[parents[k]] + 1;
+      max_depth = std::max(max_depth, depths[k]);
+    }
+    if (max_depth <= max_length) { break; }
+
+    for (const int s : symbols) { f[s] = (f[s] + 1) / 2; }
+  }
+
+  std::fill(lengths, lengths + n_symbols, 0);
+  for (int k = 0; k < m; ++k) { lengths[symbols[k]] = depths[k]; }
+}
+
+// canonical huffman codes from code lengths
+// codes are bit reversed, so that they are written LSB first as they are
+inline void huffman_codes(const uint8_t* lengths, int n_symbols,
+                          uint16_t* codes)
+{
+  int counts[16] = {};
+  for (int s = 0; s < n_symbols; ++s) { counts[lengths[s]]++; }
+  counts[0] = 0;
+
+  int next_codes[16] = {};
+  for (int length = 1; length < 16; ++length) {
+    next_codes[length] = (next_codes[length - 1] + counts[length - 1]) << 1;
+  }
+
+  for (int s = 0; s < n_symbols; ++s) {
+    const int length = lengths[s];
+    if (length == 0) { continue; }
+    const int code = next_codes[length]++;
+    uint16_t reversed = 0;
+    for (int k = 0; k < length; ++k) {
+      reversed = (reversed << 1) | ((code >> k) & 1);
+    }
+    codes[s] = reversed;
+  }
+}
+
+// LZ77 token of deflate, which is literal byte or match
+// match has flag in MSB, length in bits 16-24 and distance in lower 16 bits
+inline uint32_t match_token(int length, int distance)
+{
+  return 0x80000000u | (length << 16) | distance;
+}
+
+// write tokens as one huffman block
+// dynamic huffman codes fitted to tokens are used, or fixed codes if they
+// make smaller block, which happens for short blocks
+inline void write_huffman_block(const std::vector<uint32_t>& tokens,
+                                bool final, BitWriter& writer)
+{
+  // frequencies of literal/length and distance symbols
+  uint32_t literal_frequencies[286] = {};
+  uint32_t distance_frequencies[30] = {};
+  for (const uint32_t token : tokens) {
+    if (token & 0x80000000u) {
+      literal_frequencies[257 + length_symbol((token >> 16) & 0x1ff)]++;
+      distance_frequencies[distance_symbol(token & 0xffff)]++;
+    } else {
+      literal_frequencies[token]++;
+    }
+  }
+  literal_frequencies[256] = 1;
+
+  uint8_t lengths[286 + 30];
+  huffman_code_lengths(literal_frequencies, 286, 15, lengths);
+  huffman_code_lengths(distance_frequencies, 30, 15, lengths + 286);
+
+  int n_literals = 286;
+  while (n_literals > 257 && lengths[n_literals - 1] == 0) { n_literals--; }
+  int n_distances = 30;
+  while (n_distances > 1 && lengths[286 + n_distances - 1] == 0) {
+    n_distances--;
+  }
+
+  // run length coding of code lengths of both codes
+  // code length symbol and its extra bits are packed as symbol | extra << 8
+  uint8_t all_lengths[286 + 30];
+  std::copy(lengths, lengths + n_literals, all_lengths);
+  std::copy(lengths + 286, lengths + 286 + n_distances,
+            all_lengths + n_literals);
+  const int n_lengths = n_literals + n_distances;
+  std::vector<uint16_t> length_tokens;
+  for (int k = 0; k < n_lengths;) {
+    const uint8_t value = all_lengths[k];
+    int run = 1;
+    while (k + run < n_lengths && all_lengths[k + run] == value) { run++; }
+    k += run;
+
+    if (value == 0) {
+      while (run >= 11) {
+        const int n = std::min(run, 138);
+        length_tokens.push_back(18 | (n - 11) << 8);
+        run -= n;
+      }
+      if (run >= 3) {
+        length_tokens.push_back(17 | (run - 3) << 8);
+        run = 0;
+      }
+    } else {
+      length_tokens.push_back(value);
+      run--;
+      while (run >= 3) {
+        const int n = std::min(run, 6);
+        length_tokens.push_back(16 | (n - 3) << 8);
+        run -= n;
+      }
+    }
+    while (run-- > 0) { length_tokens.push_back(value); }
+  }
+
+  uint32_t length_frequencies[19] = {};
+  for (const uint16_t t : length_tokens) { length_frequencies[t & 0xff]++; }
+  uint8_t length_lengths[19];
+  huffman_code_lengths(length_frequencies, 19, 7, length_lengths);
+  int n_length_codes = 19;
+  while (n_length_codes > 4 &&
+         length_lengths[CODE_LENGTH_ORDER[n_length_codes - 1]] == 0) {
+    n_length_codes--;
+  }
+
+  // fixed codes
+  static const std::array<uint8_t, 288 + 30> fixed_lengths = []() {
+    std::array<uint8_t, 288 + 30> l = {};
+    std::fill(l.begin(), l.begin() + 144, 8);
+    std::fill(l.begin() + 144, l.begin() + 256, 9);
+    std::fill(l.begin() + 256, l.begin() + 280, 7);
+    std::fill(l.begin() + 280, l.begin() + 288, 8);
+    std::fill(l.begin() + 288, l.end(), 5);
+    return l;
+  }();
+
+  // compare sizes of block without extra bits, which are same for both
+  uint64_t dynamic_bits = 14 + 3 * n_length_codes;
+  constexpr int LENGTH_EXTRA_BITS[19] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                         0, 0, 0, 0, 0, 0, 2, 3, 7};
+  for (int s = 0; s < 19; ++s) {
+    dynamic_bits +=
+        length_frequencies[s] * (length_lengths[s] + LENGTH_EXTRA_BITS[s]);
+  }
+  uint64_t fixed_bits = 0;
+  for (int s = 0; s < 286; ++s) {
+    dynamic_bits += literal_frequencies[s] * lengths[s];
+    fixed_bits += literal_frequencies[s] * fixed_lengths[s];
+  }
+  for (int s = 0; s < 30; ++s) {
+    dynamic_bits += distance_frequencies[s] * lengths[286 + s];
+    fixed_bits += distance_frequencies[s] * 5;
+  }
+
+  uint16_t literal_codes[288] = {};
+  uint16_t distance_codes[30] = {};
+  const uint8_t* literal_lengths = lengths;
+  const uint8_t* distance_lengths = lengths + 286;
+  writer.write(final ? 1 : 0, 1);
+  if (fixed_bits <= dynamic_bits) {
+    writer.write(1, 2);
+    literal_lengths = fixed_lengths.data();
+    distance_lengths = fixed_lengths.data() + 288;
+    huffman_codes(literal_lengths, 288, literal_codes);
+    huffman_codes(distance_lengths, 30, distance_codes);
+  } else {
+    writer.write(2, 2);
+    writer.write(n_literals - 257, 5);
+    writer.write(n_distances - 1, 5);
+    writer.write(n_length_codes - 4, 4);
+    for (int k = 0; k < n_length_codes; ++k) {
+      writer.write(length_lengths[CODE_LENGTH_ORDER[k]], 3);
+    }
+    uint16_t length_codes[19] = {};
+    huffman_codes(length_lengths, 19, length_codes);
+    for (const uint16_t t : length_tokens) {
+      const int symbol = t & 0xff;
+      writer.write(length_codes[symbol], length_lengths[symbol]);
+      if (symbol >= 16) { writer.write(t >> 8, LENGTH_EXTRA_BITS[symbol]); }
+    }
+    huffman_codes(literal_lengths, 286, literal_codes);
+    huffman_codes(distance_lengths, 30, distance_codes);
+  }
+
+  for (const uint32_t token : tokens) {
+    if (token & 0x80000000u) {
+      const int length = (token >> 16) & 0x1ff;
+      const int distance = token & 0xffff;
+      const int l = length_symbol(length);
+      writer.write(literal_codes[257 + l], literal_lengths[257 + l]);
+      writer.write(length - LENGTH_BASE[l], LENGTH_EXTRA[l]);
+      const int d = distance_symbol(distance);
+      writer.write(distance_codes[d], distance_lengths[d]);
+      writer.write(distance - DISTANCE_BASE[d], DISTANCE_EXTRA[d]);
+    } else {
+      writer.write(literal_codes[token], literal_lengths[token]);
+    }
+  }
+  writer.write(literal_codes[256], literal_lengths[256]);
+}
+
+// compress data into raw deflate blocks with huffman codes and LZ77
+// level: 0(store) to 9(best), which controls effort of match search
+// final: if false, blocks end with empty stored block(sync flush) instead of
+// final block, so that output of consecutive data can be concatenated into
+// one deflate stream. matches never refer to data before this call.
+inline void deflate(const unsigned char* data, size_t size, int level,
+                    bool final, std::vector<unsigned char>& out)
+{
+  BitWriter writer(out);
+
+  // stored blocks
+  if (level <= 0) {
+    size_t offset = 0;
+    do {
+      const size_t n = std::min<size_t>(size - offset, 65535);
+      const bool last = offset + n == size;
+      writer.write(final && last ? 1 : 0, 1);
+      writer.write(0, 2);
+      writer.align();
+      writer.write(n, 16);
+      writer.write(~n & 0xffff, 16);
+      out.insert(out.end(), data + offset, data + offset + n);
+      offset += n;
+    } while (offset < size);
+    return;
+  }
+
+  constexpr int WINDOW_SIZE = 32768;
+  constexpr int MIN_MATCH = 3;
+  constexpr int MAX_MATCH = 258;
+  constexpr int HASH_BITS = 15;
+
+  // search parameters of each level, same as zlib
+  struct Parameters {
+    int good_length;  // search quarter of chain when match is this long
+    int lazy_length;  // try lazy matching only when match is shorter
+    int nice_length;  // stop search when match is this long
+    int max_chain;    // maximum number of candidates to search
+  };
+  static constexpr Parameters PARAMETERS[10] = {
+      {0, 0, 0, 0},        {4, 4, 8, 4},       {4, 5, 16, 8},
+      {4, 6, 32, 32},      {4, 4, 16, 16},     {8, 16, 32, 32},
+      {8, 16, 128, 128},   {8, 32, 128, 256},  {32, 128, 258, 1024},
+      {32, 258, 258, 4096}};
+  const Parameters& parameters = PARAMETERS[std::min(level, 9)];
+
+  // hash chains of 3 byte sequences
+  std::vector<int32_t> head(1 << HASH_BITS, -1);
+  std::vector<int32_t> prev(size);
+  const auto hash = [&](size_t i) {
+    const uint32_t v = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16);
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+  };
+  const auto insert = [&](size_t i) {
+    if (i + MIN_MATCH > size) { return; }
+    const uint32_t h = hash(i);
+    prev[i] = head[h];
+    head[h] = i;
+  };
+
+  // longest match at i among inserted positions
+  const auto findMatch = [&](size_t i, int max_chain, int& distance) {
+    if (i + MIN_MATCH > size) { return 0; }
+    const int max_length = std::min<size_t>(MAX_MATCH, size - i);
+    const int nice_length = std::min(parameters.nice_length, max_length);
+    int best_length = MIN_MATCH - 1;
+    int32_t candidate = head[hash(i)];
+    for (int chain = 0; chain < max_chain && candidate >= 0 &&
+                        i - candidate <= WINDOW_SIZE;
+         ++chain, candidate = prev[candidate]) {
+      // candidate can't be longer if byte at best_length differs
+      if (data[candidate + best_length] != data[i + best_length]) {
+        continue;
+      }
+      int length = 0;
+      while (length < max_length &&
+             data[candidate + length] == data[i + length]) {
+        length++;
+      }
+      if (length > best_length) {
+        best_length = length;
+        distance = i - candidate;
+        if (length >= nice_length) { break; }
+      }
+    }
+    return best_length >= MIN_MATCH ? best_length : 0;
+  };
+
+  // tokens are written in blocks, whose huffman codes fit their data
+  constexpr size_t BLOCK_TOKENS = 1 << 15;
+  std::vector<uint32_t> tokens;
+  tokens.reserve(BLOCK_TOKENS);
+  const auto push = [&](uint32_t token) {
+    tokens.push_back(token);
+    if (tokens.size() == BLOCK_TOKENS) {
+      write_huffman_block(tokens, false, writer);
+      tokens.clear();
+    }
+  };
+
+  size_t i = 0;
+  while (i < size) {
+    int distance;
+    const int length = findMatch(i, parameters.max_chain, distance);
+    insert(i);
+
+    // lazy matching: emit literal if next position has longer match
+    const int lazy_chain = length >= parameters.good_length
+                               ? parameters.max_chain / 4
+                               : parameters.max_chain;
+    int next_distance;
+    if (length == 0 || (length < parameters.lazy_length &&
+                        findMatch(i + 1, lazy_chain, next_distance) > length)) {
+      push(data[i]);
+      i++;
+      continue;
+    }
+
+    push(match_token(length, distance));
+    for (int k = 1; k < length; ++k) { insert(i + k); }
+    i += length;
+  }
+
+  // last block, which is empty if size is multiple of block
+  write_huffman_block(tokens, final, writer);
+
+  if (final) {
+    writer.align();
+  } else {
+    // empty stored block aligns stream to byte boundary
+    writer.write(0, 3);
+    writer.align();
+    writer.write(0x0000, 16);
+    writer.write(0xffff, 16);
+  }
+}
+
+// reader of deflate bit stream(LSB first)
+class BitReader
+{
+ public:
+  BitReader(const unsigned char* data, size_t size)
+      : m_data(data), m_size(size)
+  {
+  }
+
+  // read n(<= 16) bits
+  uint32_t read(int n)
+  {
+    while (m_n_bits < n) {
+      if (m_position >= m_size) {
+        throw std::runtime_error("unexpected end of deflate stream");
+      }
+      m_bits |= static_cast<uint32_t>(m_data[m_position++]) << m_n_bits;
+      m_n_bits += 8;
+    }
+    const uint32_t value = m_bits & ((1u << n) - 1);
+    m_bits >>= n;
+    m_n_bits -= n;
+    return value;
+  }
+
+  // skip to byte boundary
+  void align()
+  {
+    m_bits >>= m_n_bits % 8;
+    m_n_bits -= m_n_bits % 8;
+  }
+
+  // number of bytes consumed, which is exact after align
+  size_t getPosition() const { return m_position - m_n_bits / 8; }
+
+ private:
+  const unsigned char* m_data;
+  size_t m_size;
+  size_t m_position = 0;  // next byte to read
+  uint32_t m_bits = 0;    // pending bits
+  int m_n_bits = 0;       // number of pending bits
+};
+
+// canonical huffman code for decoding
+class HuffmanDecoder
+{
+ public:
+  // lengths: code length of each symbol, 0 if symbol isn't used
+  HuffmanDecoder(const uint8_t* lengths, int n_symbols)
+  {
+    for (int s = 0; s < n_symbols; ++s) { m_counts[lengths[s]]++; }
+    m_counts[0] = 0;
+
+    // reject over subscribed code
+    int left = 1;
+    for (int length = 1; length <= MAX_LENGTH; ++length) {
+      left = 2 * left - m_counts[length];
+      if (left < 0) { throw std::runtime_error("invalid huffman code"); }
+    }
+
+    // symbols sorted by code
+    int offsets[MAX_LENGTH + 2] = {};
+    for (int length = 1; length <= MAX_LENGTH; ++length) {
+      offsets[length + 1] = offsets[length] + m_counts[length];
+    }
+    m_symbols.resize(offsets[MAX_LENGTH + 1]);
+    for (int s = 0; s < n_symbols; ++s) {
+      if (lengths[s] != 0) { m_symbols[offsets[lengths[s]]++] = s; }
+    }
+  }
+
+  // decode one symbol, code is read bit by bit from MSB
+  int decode(BitReader& reader) const
+  {
+    int code = 0;   // code read so far
+    int first = 0;  // first code of length
+    int index = 0;  // index of first code of length in symbols
+    for (int length = 1; length <= MAX_LENGTH; ++length) {
+      code |= reader.read(1);
+      const int count = m_counts[length];
+      if (code - first < count) { return m_symbols[index + code - first]; }
+      index += count;
+      first = (first + count) << 1;
+      code <<= 1;
+    }
+    throw std::runtime_error("invalid huffman code");
+  }
+
+ private:
+  static constexpr int MAX_LENGTH = 15;
+
+  int m_counts[MAX_LENGTH + 1] = {};  // number of codes of each length
+  std::vector<uint16_t> m_symbols;    // symbols ordered by code
+};
+
+// decompress raw deflate stream, which is appended to out
+// return: number of bytes of stream
+inline size_t inflate(const unsigned char* data, size_t size,
+                      std::vector<unsigned char>& out)
+{
+  BitReader reader(data, size);
+  const size_t start = out.size();
+
+  // decode literals and matches of huffman block
+  const auto decodeBlock = [&](const HuffmanDecoder& literal,
+                               const HuffmanDecoder& distance) {
+    while (true) {
+      int symbol = literal.decode(reader);
+      if (symbol < 256) {
+        out.push_back(symbol);
+        continue;
+      }
+      if (symbol == 256) { return; }
+
+      symbol -= 257;
+      if (symbol >= 29) { throw std::runtime_error("invalid length symbol"); }
+      const int length =
+          LENGTH_BASE[symbol] + reader.read(LENGTH_EXTRA[symbol]);
+
+      const int d = distance.decode(reader);
+      if (d >= 30) { throw std::runtime_error("invalid distance symbol"); }
+      const size_t dist = DISTANCE_BASE[d] + reader.read(DISTANCE_EXTRA[d]);
+      if (dist > out.size() - start) {
+        throw std::runtime_error("distance too far back");
+      }
+
+      // copy byte by byte since match can overlap itself
+      for (int k = 0; k < length; ++k) {
+        out.push_back(out[out.size() - dist]);
+      }
+    }
+  };
+
+  bool final = false;
+  while (!final) {
+    final = reader.read(1);
+    const uint32_t type = reader.read(2);
+
+    if (type == 0) {
+      // stored block
+      reader.align();
+      const uint32_t length = reader.read(16);
+      if ((~reader.read(16) & 0xffff) != length) {
+        throw std::runtime_error("invalid stored block length");
+      }
+      for (uint32_t k = 0; k < length; ++k) { out.push_back(reader.read(8)); }
+    } else if (type == 1) {
+      // fixed huffman codes
+      static const HuffmanDecoder fixed_literal = []() {
+        uint8_t lengths[288];
+        std::fill(lengths, lengths + 144, 8);
+        std::fill(lengths + 144, lengths + 256, 9);
+        std::fill(lengths + 256, lengths + 280, 7);
+        std::fill(lengths + 280, lengths + 288, 8);
+        return HuffmanDecoder(lengths, 288);
+      }();
+      static const HuffmanDecoder fixed_distance = []() {
+        uint8_t lengths[30];
+        std::fill(lengths, lengths + 30, 5);
+        return HuffmanDecoder(lengths, 30);
+      }();
+      decodeBlock(fixed_literal, fixed_distance);
+    } else if (type == 2) {
+      // dynamic huffman codes, whose code lengths are huffman coded
+      const int n_literals = reader.read(5) + 257;
+      const int n_distances = reader.read(5) + 1;
+      const int n_length_codes = reader.read(4) + 4;
+
+      uint8_t length_lengths[19] = {};
+      for (int k = 0; k < n_length_codes; ++k) {
+        length_lengths[CODE_LENGTH_ORDER[k]] = reader.read(3);
+      }
+      const HuffmanDecoder length_decoder(length_lengths, 19);
+
+      uint8_t lengths[286 + 30] = {};
+      int n = 0;
+      while (n < n_literals + n_distances) {
+        const int symbol = length_decoder.decode(reader);
+        if (symbol < 16) {
+          lengths[n++] = symbol;
+          continue;
+        }
+
+        // repeat previous length or zeros
+        int repeat;
+        uint8_t value = 0;
+        if (symbol == 16) {
+          if (n == 0) { throw std::runtime_error("no length to repeat"); }
+          value = lengths[n - 1];
+          repeat = 3 + reader.read(2);
+        } else if (symbol == 17) {
+          repeat = 3 + reader.read(3);
+        } else {
+          repeat = 11 + reader.read(7);
+        }
+        if (n + repeat > n_literals + n_distances) {
+          throw std::runtime_error("too many code lengths");
+        }
+        while (repeat-- > 0) { lengths[n++] = value; }
+      }
+
+      decodeBlock(HuffmanDecoder(lengths, n_literals),
+                  HuffmanDecoder(lengths + n_literals, n_distances));
+    } else {
+      throw std::runtime_error("invalid deflate block type");
+    }
+  }
+
+  reader.align();
+  return reader.getPosition();
+}
+
+// decompress zlib stream, and check its adler-32
+inline std::vector<unsigned char> zlib_decompress(const unsigned char* data,
+                                                  size_t size)
+{
+  // CMF: deflate, FLG: check bits and no preset dictionary
+  if (size < 6 || (data[0] & 0x0f) != 8 ||
+      ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20) != 0) {
+    throw std::runtime_error("invalid zlib header");
+  }
+
+  std::vector<unsigned char> out;
+  const size_t n = 2 + inflate(data + 2, size - 2, out);
+  if (n + 4 > size) { throw std::runtime_error("missing adler-32"); }
+
+  const uint32_t adler = (static_cast<uint32_t>(data[n]) << 24) |
+                         (data[n + 1] << 16) | (data[n + 2] << 8) |
+                         data[n + 3];
+  if (adler32(out.data(), out.size()) != adler) {
+    throw std::runtime_error("adler-32 mismatch");
+  }
+  return out;
+}
\ No newline at end of file
@@ -0,0 +1,244 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "aov.h"
+#include "glm/glm.hpp"
+#include "image.h"
+
+// edge avoiding a-trous wavelet denoiser guided by AOVs
+// radiance is divided by albedo(demodulation) so that texture isn't blurred,
+// and the irradiance is filtered with 5x5 B3 spline kernel whose taps are
+// spread by 2^k pixels at k-th iteration. weight of each tap is reduced by
+// difference of irradiance, normal, depth and albedo from center pixel.
+// all buffers are planar, and each row is processed in parallel with the
+// loop over pixels vectorized for each tap.
+// Dammertz, H., et al. (2010). Edge-avoiding A-Trous wavelet transform for
+// fast global illumination filtering.
+class Denoiser
+{
+ public:
+  // n_iterations: number of a-trous iterations, filter radius is 2^(n+1)
+  // sigma_color: tolerance of relative difference of irradiance, which is
+  // halved at each iteration as noise is reduced
+  // sigma_normal: tolerance of distance between normals
+  // sigma_depth: tolerance of relative depth difference per pixel
+  // sigma_albedo: tolerance of distance between albedos
+  Denoiser(int n_iterations = 5, float sigma_color = 2.0f,
+           float sigma_normal = 0.3f, float sigma_depth = 0.05f,
+           float sigma_albedo = 0.1f)
+      : m_n_iterations(n_iterations),
+        m_sigma_color(sigma_color),
+        m_sigma_normal(sigma_normal),
+        m_sigma_depth(sigma_depth),
+        m_sigma_albedo(sigma_albedo)
+  {
+  }
+
+  // AOVs which must be registered to AOVBuffer given to denoise
+  static std::vector<AOV> getRequiredAOVs()
+  {
+    return {AOV::ALBEDO, AOV::NORMAL, AOV::DEPTH};
+  }
+
+  // denoise image of linear radiance in place
+  // this is done before post processing
+  void denoise(Image& image, const AOVBuffer& aov) const
+  {
+    for (const AOV required : getRequiredAOVs()) {
+      if (!aov.has(required)) {
+        throw std::runtime_error(std::string("missing AOV ") +
+                                 aov_name(required));
+      }
+    }
+
+    const int width = image.getWidth();
+    const int height = image.getHeight();
+    const int n = width * height;
+    float* pixels = image.getPtr();
+
+    // demodulate albedo, pixels of dark albedo are kept as is
+    std::vector<float> color(3 * n);
+    std::vector<float> filtered(3 * n);
+    for (int c = 0; c < 3; ++c) {
+      const float* albedo = aov.getChannel(AOV::ALBEDO, c);
+#pragma omp parallel for simd
+      for (int idx = 0; idx < n; ++idx) {
+        color[c * n + idx] = pixels[3 * idx + c] / demodulation(albedo[idx]);
+      }
+    }
+
+    for (int k = 0; k < m_n_iterations; ++k) {
+      const float sigma_color = m_sigma_color / (1 << k);
+      filter(width, height, 1 << k, sigma_color, color.data(), aov,
+             filtered.data());
+      color.swap(filtered);
+    }
+
+    // remodulate albedo
+    for (int c = 0; c < 3; ++c) {
+      const float* albedo = aov.getChannel(AOV::ALBEDO, c);
+#pragma omp parallel for simd
+      for (int idx = 0; idx < n; ++idx) {
+        pixels[3 * idx + c] = color[c * n + idx] * demodulation(albedo[idx]);
+      }
+    }
+  }
+
+ private:
+  // albedo below this isn't demodulated
+  static constexpr float ALBEDO_EPS = 1e-3f;
+  // added to luminance in relative difference to suppress dark pixels
+  static constexpr float LUMINANCE_EPS = 1e-2f;
+
+  int m_n_iterations;    // number of iterations
+  float m_sigma_color;   // tolerance of irradiance difference
+  float m_sigma_normal;  // tolerance of normal difference
+  float m_sigma_depth;   // tolerance of depth difference
+  float m_sigma_albedo;  // tolerance of albedo difference
+
+  static float demodulation(float albedo)
+  {
+    return albedo > ALBEDO_EPS ? albedo : 1.0f;
+  }
+
+  // exp(-t) for t >= 0 with relative error below 1e-5
+  // unlike std::exp, this is inlined into vectorized loop. t is clamped on
+  // its bits, since float comparison prevents vectorization unless
+  // -fno-trapping-math. exp(-t) of large t(and NaN) is flushed to ~1e-38.
+  static float expNegative(float t)
+  {
+    constexpr float T_MAX = 87.0f;
+    int32_t t_bits, max_bits;
+    std::memcpy(&t_bits, &t, sizeof(float));
+    std::memcpy(&max_bits, &T_MAX, sizeof(float));
+    t_bits = t_bits < max_bits ? t_bits : max_bits;
+    std::memcpy(&t, &t_bits, sizeof(float));
+
+    // e^-t = 2^k * e^f, where k is round(-t / ln2) and |f| <= ln2 / 2
+    // k is taken from bits after adding 1.5 * 2^23
+    constexpr float ROUND = 12582912.0f;
+    const float y = -t * 1.44269504f;
+    const float r = y + ROUND;
+    int32_t k;
+    std::memcpy(&k, &r, sizeof(float));
+    k -= 0x4b400000;
+    const float f = (y - (r - ROUND)) * 0.693147181f;
+
+    // taylor series of e^f
+    const float p =
+        1.0f +
+        f * (1.0f +
+             f * (1.0f / 2.0f +
+                  f * (1.0f / 6.0f +
+                       f * (1.0f / 24.0f + f * (1.0f / 120.0f)))));
+    const int32_t scale_bits = (k + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &scale_bits, sizeof(float));
+    return p * scale;
+  }
+
+  // one a-trous iteration with taps spread by step pixels
+  // color, output: planar irradiance
+  void filter(int width, int height, int step, float sigma_color,
+              const float* color, const AOVBuffer& aov, float* output) const
+  {
+    constexpr float KERNEL[5] = {1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f,
+                                 1.0f / 4.0f, 1.0f / 16.0f};
+    const int n = width * height;
+
+    const float* albedo[3] = {aov.getChannel(AOV::ALBEDO, 0),
+                              aov.getChannel(AOV::ALBEDO, 1),
+                              aov.getChannel(AOV::ALBEDO, 2)};
+    const float* normal[3] = {aov.getChannel(AOV::NORMAL, 0),
+                              aov.getChannel(AOV::NORMAL, 1),
+                              aov.getChannel(AOV::NORMAL, 2)};
+    const float* depth = aov.getChannel(AOV::DEPTH);
+
+    // luminance of irradiance used by edge stopping
+    std::vector<float> luminance(n);
+#pragma omp parallel for simd
+    for (int idx = 0; idx < n; ++idx) {
+      luminance[idx] = 0.2126f * color[idx] + 0.7152f * color[n + idx] +
+                       0.0722f * color[2 * n + idx];
+    }
+
+    const float inv_color2 = 1.0f / (sigma_color * sigma_color);
+    const float inv_normal2 = 1.0f / (m_sigma_normal * m_sigma_normal);
+    const float inv_albedo2 = 1.0f / (m_sigma_albedo * m_sigma_albedo);
+
+#pragma omp parallel
+    {
+      // weighted sum of each pixel of row
+      std::vector<float> sum(3 * width);
+      std::vector<float> sum_weight(width);
+
+#pragma omp for
+      for (int j = 0; j < height; ++j) {
+        std::fill(sum.begin(), sum.end(), 0.0f);
+        std::fill(sum_weight.begin(), sum_weight.end(), 0.0f);
+
+        const int row = width * j;
+        for (int ty = 0; ty < 5; ++ty) {
+          const int y = j + (ty - 2) * step;
+          if (y < 0 || y >= height) { continue; }
+
+          for (int tx = 0; tx < 5; ++tx) {
+            const int dx = (tx - 2) * step;
+            const float h = KERNEL[ty] * KERNEL[tx];
+            // depth difference is allowed to grow with distance of tap
+            const float depth_scale =
+                m_sigma_depth * step * glm::max(glm::abs(tx - 2),
+                                                glm::abs(ty - 2));
+
+            // pixels whose tap is inside of image, so that taps are
+            // contiguous loads without gather
+            const int i_begin = glm::max(0, -dx);
+            const int i_end = glm::min(width, width - dx);
+            const int offset = width * (y - j) + dx;
+
+#pragma omp simd
+            for (int i = i_begin; i < i_end; ++i) {
+              const int p = row + i;
+              const int q = p + offset;
+
+              const float dl = luminance[q] - luminance[p];
+              const float l = LUMINANCE_EPS + luminance[p];
+              float d_normal2 = 0.0f;
+              float d_albedo2 = 0.0f;
+              for (int c = 0; c < 3; ++c) {
+                const float dn = normal[c][q] - normal[c][p];
+                const float da = albedo[c][q] - albedo[c][p];
+                d_normal2 += dn * dn;
+                d_albedo2 += da * da;
+              }
+              const float d_depth = glm::abs(depth[q] - depth[p]) /
+                                    (depth_scale * depth[p] + 1e-4f);
+
+              const float weight =
+                  h * expNegative(dl * dl / (l * l) * inv_color2 +
+                                  d_normal2 * inv_normal2 + d_depth +
+                                  d_albedo2 * inv_albedo2);
+              sum[i] += weight * color[q];
+              sum[width + i] += weight * color[n + q];
+              sum[2 * width + i] += weight * color[2 * n + q];
+              sum_weight[i] += weight;
+            }
+          }
+        }
+
+        // center tap always has positive weight
+        for (int c = 0; c < 3; ++c) {
+#pragma omp simd
+          for (int i = 0; i < width; ++i) {
+            output[c * n + row + i] = sum[c * width + i] / sum_weight[i];
+          }
+        }
+      }
+    }
+  }
+};
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "filter.h"
+#include "glm/glm.hpp"
+#include "image.h"
+
+// image of filtered samples
+// each sample is splatted to pixels around it with weights of filter, and
+// pixel keeps sum of weighted radiance and sum of weights, whose ratio is
+// reconstructed radiance
+class Film
+{
+ public:
+  // filter must outlive film
+  Film(int width, int height, const Filter& filter)
+      : m_width(width),
+        m_height(height),
+        m_filter(filter),
+        m_sum(3 * width * height, 0.0f),
+        m_weight(width * height, 0.0f)
+  {
+  }
+
+  // get width of image
+  int getWidth() const { return m_width; }
+
+  // get height of image
+  int getHeight() const { return m_height; }
+
+  // get reconstruction filter
+  const Filter& getFilter() const { return m_filter; }
+
+  // add weighted radiance and weight to pixel (i, j)
+  void add(int i, int j, const glm::vec3& weighted_radiance, float weight)
+  {
+    const int idx = i + m_width * j;
+    m_sum[3 * idx + 0] += weighted_radiance.x;
+    m_sum[3 * idx + 1] += weighted_radiance.y;
+    m_sum[3 * idx + 2] += weighted_radiance.z;
+    m_weight[idx] += weight;
+  }
+
+  // clear sums
+  void clear()
+  {
+    std::fill(m_sum.begin(), m_sum.end(), 0.0f);
+    std::fill(m_weight.begin(), m_weight.end(), 0.0f);
+  }
+
+  // write reconstructed radiance into image of same size
+  // pixels without weight are black
+  void resolve(Image& image) const
+  {
+    float* pixels = image.getPtr();
+    const int n = m_width * m_height;
+#pragma omp parallel for
+    for (int idx = 0; idx < n; ++idx) {
+      // weight can be close to 0 with negative lobes of filter
+      const float w = m_weight[idx];
+      const float inv_weight = glm::abs(w) > 1e-6f ? 1.0f / w : 0.0f;
+      for (int c = 0; c < 3; ++c) {
+        pixels[3 * idx + c] = m_sum[3 * idx + c] * inv_weight;
+      }
+    }
+  }
+
+ private:
+  int m_width;                  // width of image
+  int m_height;                 // height of image
+  const Filter& m_filter;       // reconstruction filter
+  std::vector<float> m_sum;     // sum of weighted radiance(RGB)
+  std::vector<float> m_weight;  // sum of weights
+};
\ No newline at end of file
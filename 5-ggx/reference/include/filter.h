@@ -0,0 +1,145 @@
+#pragma once
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "core.h"
+#include "glm/glm.hpp"
+
+// pixel reconstruction filter
+// filters are separable, and weight of sample is product of 1D filter of x
+// and y offsets from pixel center
+class Filter
+{
+ public:
+  // radius: filter is 0 beyond this offset in pixels
+  Filter(float radius) : m_radius(radius) {}
+
+  virtual ~Filter() = default;
+
+  // get radius of filter in pixels
+  float getRadius() const { return m_radius; }
+
+  // number of pixels reached by samples outside of the pixel, which is
+  // width of apron needed around a block of pixels
+  int getApron() const { return glm::max(glm::ceil(m_radius - 0.5f), 0.0f); }
+
+  // evaluate 1D filter at offset x of sample from pixel center
+  // support is half open [-radius, radius), so that box filter of radius 0.5
+  // assigns each sample to exactly one pixel
+  float evaluate(float x) const
+  {
+    return x >= -m_radius && x < m_radius ? evaluate1D(x) : 0.0f;
+  }
+
+  // evaluate filter at offset p of sample from pixel center
+  float evaluate(const glm::vec2& p) const
+  {
+    return evaluate(p.x) * evaluate(p.y);
+  }
+
+ protected:
+  float m_radius;  // radius of filter
+
+  // evaluate 1D filter at x in (-radius, radius)
+  virtual float evaluate1D(float x) const = 0;
+};
+
+// box filter, which is implicit filter of averaging samples of pixel
+class BoxFilter : public Filter
+{
+ public:
+  BoxFilter(float radius = 0.5f) : Filter(radius) {}
+
+ protected:
+  float evaluate1D(float x) const override { return 1.0f; }
+};
+
+// gaussian filter shifted to be 0 at radius
+class GaussianFilter : public Filter
+{
+ public:
+  GaussianFilter(float radius = 1.5f, float sigma = 0.5f)
+      : Filter(radius),
+        m_sigma(sigma),
+        m_offset(glm::exp(-radius * radius / (2.0f * sigma * sigma)))
+  {
+  }
+
+ protected:
+  float evaluate1D(float x) const override
+  {
+    return glm::max(glm::exp(-x * x / (2.0f * m_sigma * m_sigma)) - m_offset,
+                    0.0f);
+  }
+
+ private:
+  float m_sigma;   // standard deviation
+  float m_offset;  // value of gaussian at radius
+};
+
+// Mitchell-Netravali filter, which has negative lobes
+// Mitchell, D. P., & Netravali, A. N. (1988). Reconstruction filters in
+// computer-graphics.
+class MitchellFilter : public Filter
+{
+ public:
+  MitchellFilter(float radius = 2.0f, float b = 1.0f / 3.0f,
+                 float c = 1.0f / 3.0f)
+      : Filter(radius), m_b(b), m_c(c)
+  {
+  }
+
+ protected:
+  float evaluate1D(float x) const override
+  {
+    // map radius to 2
+    x = glm::abs(2.0f * x / m_radius);
+    const float x2 = x * x;
+    const float x3 = x2 * x;
+    if (x < 1.0f) {
+      return ((12.0f - 9.0f * m_b - 6.0f * m_c) * x3 +
+              (-18.0f + 12.0f * m_b + 6.0f * m_c) * x2 + (6.0f - 2.0f * m_b)) /
+             6.0f;
+    }
+    return ((-m_b - 6.0f * m_c) * x3 + (6.0f * m_b + 30.0f * m_c) * x2 +
+            (-12.0f * m_b - 48.0f * m_c) * x + (8.0f * m_b + 24.0f * m_c)) /
+           6.0f;
+  }
+
+ private:
+  float m_b;  // parameter B
+  float m_c;  // parameter C
+};
+
+// 4 term Blackman-Harris window
+// Harris, F. J. (1978). On the use of windows for harmonic analysis with the
+// discrete Fourier transform.
+class BlackmanHarrisFilter : public Filter
+{
+ public:
+  BlackmanHarrisFilter(float radius = 2.0f) : Filter(radius) {}
+
+ protected:
+  float evaluate1D(float x) const override
+  {
+    // phase of window over [-radius, radius]
+    const float t = 2.0f * M_PIf * (x + m_radius) / (2.0f * m_radius);
+    return 0.35875f - 0.48829f * glm::cos(t) + 0.14128f * glm::cos(2.0f * t) -
+           0.01168f * glm::cos(3.0f * t);
+  }
+};
+
+// make filter with default parameters from name(box, gaussian, mitchell,
+// blackman_harris)
+inline std::unique_ptr<Filter> make_filter(const std::string& name)
+{
+  if (name == "box") { return std::make_unique<BoxFilter>(); }
+  if (name == "gaussian") { return std::make_unique<GaussianFilter>(); }
+  if (name == "mitchell") { return std::make_unique<MitchellFilter>(); }
+  if (name == "blackman_harris") {
+    return std::make_unique<BlackmanHarrisFilter>();
+  }
+  throw std::runtime_error("unknown filter " + name);
+}
\ No newline at end of file
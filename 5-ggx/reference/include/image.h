@@ -1,19 +1,7 @@
 #pragma once
 
 #include "glm/glm.hpp"
-
-// linear RGB to sRGB conversion
-inline glm::vec3 linear_to_srgb(const glm::vec3& rgb)
-{
-  glm::vec3 ret;
-  ret.x = rgb.x < 0.0031308 ? 12.92 * rgb.x
-                            : 1.055 * glm::pow(rgb.x, 1.0f / 2.4f) - 0.055;
-  ret.y = rgb.y < 0.0031308 ? 12.92 * rgb.y
-                            : 1.055 * glm::pow(rgb.y, 1.0f / 2.4f) - 0.055;
-  ret.z = rgb.z < 0.0031308 ? 12.92 * rgb.z
-                            : 1.055 * glm::pow(rgb.z, 1.0f / 2.4f) - 0.055;
-  return ret;
-}
+#include "postprocess.h"
 
 class Image
 {
@@ -27,6 +15,15 @@ class Image
 
   ~Image() { delete[] m_pixels; }
 
+  // get width of image
+  int getWidth() const { return m_width; }
+
+  // get height of image
+  int getHeight() const { return m_height; }
+
+  // get pointer of image
+  float* getPtr() { return m_pixels; }
+
   // get const pointer of image
   const float* getConstPtr() const { return m_pixels; }
 
@@ -58,45 +55,23 @@ class Image
   // clear image
   void clear()
   {
-    for (int j = 0; j < m_height; ++j) {
-      for (int i = 0; i < m_width; ++i) {
-        const int idx = 3 * i + 3 * m_width * j;
-        m_pixels[idx] = 0.0f;
-        m_pixels[idx + 1] = 0.0f;
-        m_pixels[idx + 2] = 0.0f;
-      }
-    }
+    const int n = 3 * m_width * m_height;
+#pragma omp parallel for simd
+    for (int k = 0; k < n; ++k) { m_pixels[k] = 0.0f; }
   }
 
   // divide all pixels by k
   void divide(float k)
   {
-    for (int j = 0; j < m_height; ++j) {
-      for (int i = 0; i < m_width; ++i) {
-        const int idx = 3 * i + 3 * m_width * j;
-        m_pixels[idx] /= k;
-        m_pixels[idx + 1] /= k;
-        m_pixels[idx + 2] /= k;
-      }
-    }
+    const int n = 3 * m_width * m_height;
+#pragma omp parallel for simd
+    for (int idx = 0; idx < n; ++idx) { m_pixels[idx] /= k; }
   }
 
-  // apply linear RGB to sRGB conversion
-  void post_process()
+  // apply exposure, tone mapping and linear RGB to sRGB conversion
+  void post_process(const PostProcess& post_process = PostProcess())
   {
-    for (int j = 0; j < m_height; ++j) {
-      for (int i = 0; i < m_width; ++i) {
-        const int idx = 3 * i + 3 * m_width * j;
-        glm::vec3 c =
-            glm::vec3(m_pixels[idx], m_pixels[idx + 1], m_pixels[idx + 2]);
-
-        c = linear_to_srgb(c);
-
-        m_pixels[idx] = c.x;
-        m_pixels[idx + 1] = c.y;
-        m_pixels[idx + 2] = c.z;
-      }
-    }
+    post_process.apply(m_pixels, m_width, m_height);
   }
 
  private:
@@ -1,9 +1,11 @@
 #pragma once
 #include <algorithm>
 
+#include "aov.h"
 #include "bsdf.h"
 #include "core.h"
 #include "intersector.h"
+#include "light.h"
 #include "sampler.h"
 #include "sky.h"
 
@@ -14,8 +16,10 @@ class Integrator
  public:
   // compute incoming radiance by numerically computing rendering equation
   // ray: ray generated from camera
+  // aov: requested AOVs are set if not nullptr
   virtual glm::vec3 integrate(const Ray& ray, const Intersector& intersector,
-                              const Sky& sky, Sampler& sampler) const = 0;
+                              const Sky& sky, Sampler& sampler,
+                              AOVSample* aov = nullptr) const = 0;
 };
 
 // pure path tracing integrator
@@ -25,7 +29,8 @@ class PathTracing : public Integrator
   PathTracing(uint32_t max_depth) : m_max_depth(max_depth) {}
 
   glm::vec3 integrate(const Ray& ray_in, const Intersector& intersector,
-                      const Sky& sky, Sampler& sampler) const override
+                      const Sky& sky, Sampler& sampler,
+                      AOVSample* aov = nullptr) const override
   {
     Ray ray = ray_in;
     glm::vec3 radiance(0.0f);
@@ -33,13 +38,20 @@ class PathTracing : public Integrator
 
     for (int depth = 0; depth < m_max_depth; ++depth) {
       // russian roulette
-      const float russian_roulette_prob =
-          glm::max(throughput.x, glm::max(throughput.y, throughput.z));
+      const float russian_roulette_prob = glm::min(
+          glm::max(throughput.x, glm::max(throughput.y, throughput.z)), 1.0f);
       if (sampler.next_1d() > russian_roulette_prob) { break; }
       throughput /= russian_roulette_prob;
 
       IntersectInfo info;
-      if (!intersector.intersect(ray, info)) {
+      const bool hit = (depth == 0 && aov != nullptr)
+                           ? aov->intersectFirstHit(ray, intersector, info)
+                           : intersector.intersect(ray, info);
+      if (depth == 0 && aov != nullptr) {
+        aov->setFirstHit(ray, hit, info, intersector, sky);
+      }
+
+      if (!hit) {
         // ray goes to sky
         // evaluate environment light
         radiance += throughput * sky.evaluate(ray);
@@ -81,4 +93,333 @@ class PathTracing : public Integrator
 
  private:
   uint32_t m_max_depth;  // maximum ray depth
+};
+
+// path tracing integrator with next event estimation(NEE)
+// area lights are sampled explicitly at each bounce, and emission found by
+// BSDF sampling is ignored except for camera rays to avoid double counting
+class PathTracingNEE : public Integrator
+{
+ public:
+  PathTracingNEE(uint32_t max_depth, const LightSampler* light_sampler)
+      : m_max_depth(max_depth), m_light_sampler(light_sampler)
+  {
+  }
+
+  glm::vec3 integrate(const Ray& ray_in, const Intersector& intersector,
+                      const Sky& sky, Sampler& sampler,
+                      AOVSample* aov = nullptr) const override
+  {
+    Ray ray = ray_in;
+    glm::vec3 radiance(0.0f);
+    glm::vec3 throughput(1.0f);
+
+    for (int depth = 0; depth < m_max_depth; ++depth) {
+      // russian roulette
+      const float russian_roulette_prob = glm::min(
+          glm::max(throughput.x, glm::max(throughput.y, throughput.z)), 1.0f);
+      if (sampler.next_1d() > russian_roulette_prob) { break; }
+      throughput /= russian_roulette_prob;
+
+      IntersectInfo info;
+      const bool hit = (depth == 0 && aov != nullptr)
+                           ? aov->intersectFirstHit(ray, intersector, info)
+                           : intersector.intersect(ray, info);
+      if (depth == 0 && aov != nullptr) {
+        aov->setFirstHit(ray, hit, info, intersector, sky);
+      }
+
+      if (!hit) {
+        // ray goes to sky
+        // evaluate environment light
+        radiance += throughput * sky.evaluate(ray);
+        break;
+      }
+
+      if (info.primitive->has_emission()) {
+        // ray hits area light
+        // add Le only for camera ray, since it is already counted by NEE
+        if (depth == 0) {
+          radiance += throughput * info.primitive->material->emission_color;
+        }
+        break;
+      }
+
+      // compute tangent space basis
+      glm::vec3 tangent, bitangent;
+      orthonormal_basis(info.normal, tangent, bitangent);
+
+      // setup BSDF
+      const auto bsdf = DiffuseSpecularMetal(info);
+
+      const glm::vec3 wo =
+          world_to_local(-ray.direction, tangent, info.normal, bitangent);
+      const glm::vec3 origin = info.position + RAY_EPS * info.normal;
+
+      // next event estimation
+      // light path is one segment longer, so skip it at the last depth to
+      // match maximum path length of BSDF sampling
+      if (depth + 1 < m_max_depth) {
+        radiance += throughput * sampleLight(origin, wo, tangent, info.normal,
+                                             bitangent, bsdf, intersector,
+                                             sampler);
+      }
+
+      // sample direction from BSDF
+      glm::vec3 f;
+      float pdf;
+      const glm::vec3 wi = bsdf.sampleDirection(sampler.next_2d(),
+                                                sampler.next_1d(), wo, f, pdf);
+
+      // update throughput
+      throughput *= f * abs_cos_theta(wi) / pdf;
+
+      // update ray
+      ray.origin = origin;
+      ray.direction = local_to_world(wi, tangent, info.normal, bitangent);
+    }
+
+    return radiance;
+  }
+
+ private:
+  uint32_t m_max_depth;                 // maximum ray depth
+  const LightSampler* m_light_sampler;  // used for selecting light
+
+  // compute direct illumination from one sampled light
+  glm::vec3 sampleLight(const glm::vec3& origin, const glm::vec3& wo,
+                        const glm::vec3& t, const glm::vec3& n,
+                        const glm::vec3& b, const BSDF& bsdf,
+                        const Intersector& intersector, Sampler& sampler) const
+  {
+    // select light
+    float light_pmf;
+    const AreaLight* light =
+        m_light_sampler->sample(origin, sampler.next_1d(), light_pmf);
+    const glm::vec2 u = sampler.next_2d();
+    if (light == nullptr || light_pmf == 0.0f) { return glm::vec3(0.0f); }
+
+    // sample point on light
+    glm::vec3 light_normal;
+    float light_pdf;
+    const glm::vec3 p_light = light->samplePoint(u, light_normal, light_pdf);
+
+    // convert pdf from area measure to solid angle measure
+    const glm::vec3 d = p_light - origin;
+    const float dist2 = glm::dot(d, d);
+    const float dist = glm::sqrt(dist2);
+    const glm::vec3 wi_world = d / dist;
+    const float cos_light = glm::abs(glm::dot(light_normal, wi_world));
+    if (cos_light == 0.0f) { return glm::vec3(0.0f); }
+    const float pdf = light_pmf * light_pdf * dist2 / cos_light;
+
+    // evaluate BSDF
+    const glm::vec3 wi = world_to_local(wi_world, t, n, b);
+    const glm::vec3 f = bsdf.evaluate(wo, wi);
+    if (f == glm::vec3(0.0f)) { return glm::vec3(0.0f); }
+
+    // test visibility
+    Ray shadow_ray(origin, wi_world);
+    shadow_ray.tmax = dist - RAY_EPS;
+    if (intersector.occluded(shadow_ray)) { return glm::vec3(0.0f); }
+
+    return f * abs_cos_theta(wi) * light->Le() / pdf;
+  }
+};
+
+// power heuristic(beta = 2) for MIS weight of strategy f
+// f_pdf: pdf of strategy used to sample the direction
+// g_pdf: pdf of the other strategy
+inline float power_heuristic(float f_pdf, float g_pdf)
+{
+  const float f2 = f_pdf * f_pdf;
+  const float g2 = g_pdf * g_pdf;
+  if (f2 + g2 == 0.0f) { return 0.0f; }
+  return f2 / (f2 + g2);
+}
+
+// path tracing integrator with multiple importance sampling(MIS)
+// light sampling, sky sampling and BSDF sampling are combined with power
+// heuristic at each bounce
+// Veach, E. (1997). Robust Monte Carlo methods for light transport simulation.
+class PathTracingMIS : public Integrator
+{
+ public:
+  PathTracingMIS(uint32_t max_depth, const LightSampler* light_sampler)
+      : m_max_depth(max_depth), m_light_sampler(light_sampler)
+  {
+  }
+
+  glm::vec3 integrate(const Ray& ray_in, const Intersector& intersector,
+                      const Sky& sky, Sampler& sampler,
+                      AOVSample* aov = nullptr) const override
+  {
+    Ray ray = ray_in;
+    glm::vec3 radiance(0.0f);
+    glm::vec3 throughput(1.0f);
+
+    // pdf of BSDF sampling at previous bounce(solid angle measure)
+    float bsdf_pdf = 0.0f;
+
+    for (int depth = 0; depth < m_max_depth; ++depth) {
+      // russian roulette
+      const float russian_roulette_prob = glm::min(
+          glm::max(throughput.x, glm::max(throughput.y, throughput.z)), 1.0f);
+      if (sampler.next_1d() > russian_roulette_prob) { break; }
+      throughput /= russian_roulette_prob;
+
+      IntersectInfo info;
+      const bool hit = (depth == 0 && aov != nullptr)
+                           ? aov->intersectFirstHit(ray, intersector, info)
+                           : intersector.intersect(ray, info);
+      if (depth == 0 && aov != nullptr) {
+        aov->setFirstHit(ray, hit, info, intersector, sky);
+      }
+
+      if (!hit) {
+        // ray goes to sky
+        // weight by MIS except for camera ray
+        float weight = 1.0f;
+        if (depth > 0) {
+          weight = power_heuristic(bsdf_pdf, sky.pdf(ray.direction));
+        }
+        radiance += weight * throughput * sky.evaluate(ray);
+        break;
+      }
+
+      if (info.primitive->has_emission()) {
+        // ray hits area light
+        // weight by MIS except for camera ray
+        float weight = 1.0f;
+        if (depth > 0) {
+          // use geometric normal same as light sampling, since
+          // interpolated normal gives different pdf
+          const glm::vec3 light_normal =
+              info.primitive->shape->geometricNormal(info.position);
+          const float cos_light =
+              glm::abs(glm::dot(light_normal, ray.direction));
+          const float light_pdf =
+              m_light_sampler->pmf(ray.origin, info.primitive->shape) *
+              info.t * info.t /
+              (info.primitive->shape->area() * cos_light);
+          weight = power_heuristic(bsdf_pdf, light_pdf);
+        }
+        radiance +=
+            weight * throughput * info.primitive->material->emission_color;
+        break;
+      }
+
+      // compute tangent space basis
+      glm::vec3 tangent, bitangent;
+      orthonormal_basis(info.normal, tangent, bitangent);
+
+      // setup BSDF
+      const auto bsdf = DiffuseSpecularMetal(info);
+
+      const glm::vec3 wo =
+          world_to_local(-ray.direction, tangent, info.normal, bitangent);
+      const glm::vec3 origin = info.position + RAY_EPS * info.normal;
+
+      // light sampling and sky sampling
+      // skip them at the last depth to match maximum path length of BSDF
+      // sampling
+      if (depth + 1 < m_max_depth) {
+        radiance += throughput * sampleLight(origin, wo, tangent, info.normal,
+                                             bitangent, bsdf, intersector,
+                                             sampler);
+        radiance += throughput * sampleSky(origin, wo, tangent, info.normal,
+                                           bitangent, bsdf, intersector, sky,
+                                           sampler);
+      }
+
+      // sample direction from BSDF
+      glm::vec3 f;
+      float pdf;
+      const glm::vec3 wi = bsdf.sampleDirection(sampler.next_2d(),
+                                                sampler.next_1d(), wo, f, pdf);
+
+      // update throughput
+      throughput *= f * abs_cos_theta(wi) / pdf;
+
+      // pdf of all BxDFs is used for MIS, since light sampling evaluates
+      // all of them
+      bsdf_pdf = bsdf.pdf(wo, wi);
+
+      // update ray
+      ray.origin = origin;
+      ray.direction = local_to_world(wi, tangent, info.normal, bitangent);
+    }
+
+    return radiance;
+  }
+
+ private:
+  uint32_t m_max_depth;                 // maximum ray depth
+  const LightSampler* m_light_sampler;  // used for selecting light
+
+  // compute direct illumination from one sampled light, weighted by MIS
+  glm::vec3 sampleLight(const glm::vec3& origin, const glm::vec3& wo,
+                        const glm::vec3& t, const glm::vec3& n,
+                        const glm::vec3& b, const BSDF& bsdf,
+                        const Intersector& intersector, Sampler& sampler) const
+  {
+    // select light
+    float light_pmf;
+    const AreaLight* light =
+        m_light_sampler->sample(origin, sampler.next_1d(), light_pmf);
+    const glm::vec2 u = sampler.next_2d();
+    if (light == nullptr || light_pmf == 0.0f) { return glm::vec3(0.0f); }
+
+    // sample point on light
+    glm::vec3 light_normal;
+    float light_pdf;
+    const glm::vec3 p_light = light->samplePoint(u, light_normal, light_pdf);
+
+    // convert pdf from area measure to solid angle measure
+    const glm::vec3 d = p_light - origin;
+    const float dist2 = glm::dot(d, d);
+    const float dist = glm::sqrt(dist2);
+    const glm::vec3 wi_world = d / dist;
+    const float cos_light = glm::abs(glm::dot(light_normal, wi_world));
+    if (cos_light == 0.0f) { return glm::vec3(0.0f); }
+    const float pdf = light_pmf * light_pdf * dist2 / cos_light;
+
+    // evaluate BSDF
+    const glm::vec3 wi = world_to_local(wi_world, t, n, b);
+    const glm::vec3 f = bsdf.evaluate(wo, wi);
+    if (f == glm::vec3(0.0f)) { return glm::vec3(0.0f); }
+
+    // test visibility
+    Ray shadow_ray(origin, wi_world);
+    shadow_ray.tmax = dist - RAY_EPS;
+    if (intersector.occluded(shadow_ray)) { return glm::vec3(0.0f); }
+
+    const float weight = power_heuristic(pdf, bsdf.pdf(wo, wi));
+    return weight * f * abs_cos_theta(wi) * light->Le() / pdf;
+  }
+
+  // compute direct illumination from sampled sky direction, weighted by MIS
+  glm::vec3 sampleSky(const glm::vec3& origin, const glm::vec3& wo,
+                      const glm::vec3& t, const glm::vec3& n,
+                      const glm::vec3& b, const BSDF& bsdf,
+                      const Intersector& intersector, const Sky& sky,
+                      Sampler& sampler) const
+  {
+    // sample direction toward sky
+    float pdf;
+    const glm::vec3 wi_world = sky.sampleDirection(sampler.next_2d(), pdf);
+    if (pdf == 0.0f) { return glm::vec3(0.0f); }
+
+    // evaluate BSDF
+    const glm::vec3 wi = world_to_local(wi_world, t, n, b);
+    const glm::vec3 f = bsdf.evaluate(wo, wi);
+    if (f == glm::vec3(0.0f)) { return glm::vec3(0.0f); }
+
+    // test visibility
+    const Ray shadow_ray(origin, wi_world);
+    if (intersector.occluded(shadow_ray)) { return glm::vec3(0.0f); }
+
+    const float weight = power_heuristic(pdf, bsdf.pdf(wo, wi));
+    return weight * f * abs_cos_theta(wi) * sky.evaluate(shadow_ray) / pdf;
+  }
 };
\ No newline at end of file
@@ -20,6 +20,26 @@ class Intersector
   // find closest ray intersection
   virtual bool intersect(const Ray& ray, IntersectInfo& info) const = 0;
 
+  // same as intersect, but also count visited nodes in info.bvh_depth
+  // counting is done only here, so that intersect doesn't pay for it
+  virtual bool intersectCountingNodes(const Ray& ray, IntersectInfo& info) const
+  {
+    return intersect(ray, info);
+  }
+
+  // return true if ray hits any primitive between ray.tmin and ray.tmax
+  virtual bool occluded(const Ray& ray) const
+  {
+    IntersectInfo info;
+    return intersect(ray, info);
+  }
+
+  // get index of primitive in array of primitives
+  uint32_t getPrimitiveIndex(const Primitive* primitive) const
+  {
+    return primitive - m_primitives;
+  }
+
  protected:
   Primitive* m_primitives;  // array of primitives
   uint32_t m_n_primitives;  // number of primitives
@@ -82,16 +102,13 @@ class BVH : public Intersector
 
   bool intersect(const Ray& ray, IntersectInfo& info) const override
   {
-    // precompute inverse of ray direction, sign
-    const glm::vec3 dir_inv = 1.0f / ray.direction;
-    int dir_inv_sign[3];
-    for (int i = 0; i < 3; ++i) { dir_inv_sign[i] = dir_inv[i] > 0 ? 0 : 1; }
+    return intersectRoot<false>(ray, info);
+  }
 
-    // intersect bvh nodes from root
-    float ray_tmax = ray.tmax;
-    bool hit = intersectNode(m_root, ray, dir_inv, dir_inv_sign, info);
-    ray.tmax = ray_tmax;
-    return hit;
+  bool intersectCountingNodes(const Ray& ray,
+                              IntersectInfo& info) const override
+  {
+    return intersectRoot<true>(ray, info);
   }
 
  private:
@@ -135,10 +152,11 @@ class BVH : public Intersector
     BVHNode* node = new BVHNode;
 
     // calculate AABB
-    AABB bbox;
-    for (int i = primitive_start; i < primitive_end; ++i) {
-      bbox = bbox.mergeAABB(m_primitives[i].getBounds());
-    }
+    const auto get_bounds = [](const Primitive& primitive) {
+      return primitive.getBounds();
+    };
+    const AABB bbox = merge_bounds(m_primitives + primitive_start,
+                                   m_primitives + primitive_end, get_bounds);
 
     const int n_primitives = primitive_end - primitive_start;
     if (n_primitives <= m_n_primitives_in_leaf_node) {
@@ -146,39 +164,12 @@ class BVH : public Intersector
       return createLeafNode(node, bbox, primitive_start, n_primitives);
     }
 
-    // calculate split AABB
-    // NOTE: using bbox doesn't work well when splitting
-    AABB split_bbox;
-    for (int i = primitive_start; i < primitive_end; ++i) {
-      split_bbox = split_bbox.mergeAABB(m_primitives[i].getBounds().center());
-    }
-
-    // split axis
-    const int split_axis = split_bbox.logestAxis();
-
-    // split position
-    const float split_pos = split_bbox.center()[split_axis];
-
-    // split bounding box
-    const int split_idx = primitive_start + n_primitives / 2;
-    std::nth_element(m_primitives + primitive_start, m_primitives + split_idx,
-                     m_primitives + primitive_end,
-                     [&](const auto& prim1, const auto& prim2) {
-                       return prim1.getBounds().center()[split_axis] <
-                              prim2.getBounds().center()[split_axis];
-                     });
-
-    // if splitting failed, create leaf node
-    if (split_idx == primitive_start || split_idx == primitive_end) {
-      spdlog::info("[BVH] splitting failed");
-      spdlog::info("[BVH] n_primitives: {}", n_primitives);
-      spdlog::info("[BVH] split_axis: {}", split_axis);
-      spdlog::info("[BVH] split_pos: {}", split_pos);
-      spdlog::info("[BVH] primitive_start: {}", primitive_start);
-      spdlog::info("[BVH] split_idx: {}", split_idx);
-      spdlog::info("[BVH] primitive_end: {}", primitive_end);
-      return createLeafNode(node, bbox, primitive_start, n_primitives);
-    }
+    // split at median of primitive centers
+    int split_axis;
+    const int split_idx =
+        split_at_median(m_primitives + primitive_start,
+                        m_primitives + primitive_end, get_bounds, split_axis) -
+        m_primitives;
 
     node->bbox = bbox;
     node->primitive_indices_offset = primitive_start;
@@ -202,14 +193,32 @@ class BVH : public Intersector
     delete node;
   }
 
+  // intersect bvh nodes from root
+  template <bool COUNT_NODES>
+  bool intersectRoot(const Ray& ray, IntersectInfo& info) const
+  {
+    // precompute inverse of ray direction, sign
+    const glm::vec3 dir_inv = 1.0f / ray.direction;
+    int dir_inv_sign[3];
+    for (int i = 0; i < 3; ++i) { dir_inv_sign[i] = dir_inv[i] > 0 ? 0 : 1; }
+
+    float ray_tmax = ray.tmax;
+    bool hit = intersectNode<COUNT_NODES>(m_root, ray, dir_inv, dir_inv_sign,
+                                          info);
+    ray.tmax = ray_tmax;
+    return hit;
+  }
+
   // traverse bvh nodes recursively
+  // visited nodes are counted in info.bvh_depth if COUNT_NODES
+  template <bool COUNT_NODES>
   bool intersectNode(const BVHNode* node, const Ray& ray,
                      const glm::vec3& dir_inv, const int dir_inv_sign[3],
                      IntersectInfo& info) const
   {
     bool hit = false;
 
-    info.bvh_depth++;
+    if constexpr (COUNT_NODES) { info.bvh_depth++; }
 
     // intersect with bounding box
     if (node->bbox.intersect(ray, dir_inv, dir_inv_sign)) {
@@ -225,10 +234,12 @@ class BVH : public Intersector
         }
       } else {
         // intersect with child nodes
-        hit |= intersectNode(node->children[dir_inv_sign[node->axis]], ray,
-                             dir_inv, dir_inv_sign, info);
-        hit |= intersectNode(node->children[1 - dir_inv_sign[node->axis]], ray,
-                             dir_inv, dir_inv_sign, info);
+        hit |= intersectNode<COUNT_NODES>(
+            node->children[dir_inv_sign[node->axis]], ray, dir_inv,
+            dir_inv_sign, info);
+        hit |= intersectNode<COUNT_NODES>(
+            node->children[1 - dir_inv_sign[node->axis]], ray, dir_inv,
+            dir_inv_sign, info);
       }
     }
 
@@ -261,17 +272,24 @@ class BVHOptimized : public Intersector
   }
 
   bool intersect(const Ray& ray, IntersectInfo& info) const override
+  {
+    return intersectRoot<false>(ray, info);
+  }
+
+  bool intersectCountingNodes(const Ray& ray,
+                              IntersectInfo& info) const override
+  {
+    return intersectRoot<true>(ray, info);
+  }
+
+  bool occluded(const Ray& ray) const override
   {
     // precompute inverse of ray direction, sign
     const glm::vec3 dir_inv = 1.0f / ray.direction;
     int dir_inv_sign[3];
     for (int i = 0; i < 3; ++i) { dir_inv_sign[i] = dir_inv[i] > 0 ? 0 : 1; }
 
-    // intersect bvh nodes from root
-    float ray_tmax = ray.tmax;
-    bool hit = intersectNode(0, ray, dir_inv, dir_inv_sign, info);
-    ray.tmax = ray_tmax;
-    return hit;
+    return occludedNode(0, ray, dir_inv, dir_inv_sign);
   }
 
  private:
@@ -307,10 +325,11 @@ class BVHOptimized : public Intersector
   void buildBVHNode(int primitive_start, int primitive_end)
   {
     // calculate AABB
-    AABB bbox;
-    for (int i = primitive_start; i < primitive_end; ++i) {
-      bbox = bbox.mergeAABB(m_primitives[i].getBounds());
-    }
+    const auto get_bounds = [](const Primitive& primitive) {
+      return primitive.getBounds();
+    };
+    const AABB bbox = merge_bounds(m_primitives + primitive_start,
+                                   m_primitives + primitive_end, get_bounds);
 
     const int n_primitives = primitive_end - primitive_start;
     if (n_primitives <= 4) {
@@ -319,40 +338,12 @@ class BVHOptimized : public Intersector
       return;
     }
 
-    // calculate split AABB
-    // NOTE: using bbox doesn't work well when splitting
-    AABB split_bbox;
-    for (int i = primitive_start; i < primitive_end; ++i) {
-      split_bbox = split_bbox.mergeAABB(m_primitives[i].getBounds().center());
-    }
-
-    // split axis
-    const int split_axis = split_bbox.logestAxis();
-
-    // split position
-    const float split_pos = split_bbox.center()[split_axis];
-
-    // split bounding box
-    const int split_idx = primitive_start + n_primitives / 2;
-    std::nth_element(m_primitives + primitive_start, m_primitives + split_idx,
-                     m_primitives + primitive_end,
-                     [&](const auto& prim1, const auto& prim2) {
-                       return prim1.getBounds().center()[split_axis] <
-                              prim2.getBounds().center()[split_axis];
-                     });
-
-    // if splitting failed, create leaf node
-    if (split_idx == primitive_start || split_idx == primitive_end) {
-      spdlog::info("[BVH] splitting failed");
-      spdlog::info("[BVH] n_primitives: {}", n_primitives);
-      spdlog::info("[BVH] split_axis: {}", split_axis);
-      spdlog::info("[BVH] split_pos: {}", split_pos);
-      spdlog::info("[BVH] primitive_start: {}", primitive_start);
-      spdlog::info("[BVH] split_idx: {}", split_idx);
-      spdlog::info("[BVH] primitive_end: {}", primitive_end);
-      addLeafNode(bbox, primitive_start, n_primitives);
-      return;
-    }
+    // split at median of primitive centers
+    int split_axis;
+    const int split_idx =
+        split_at_median(m_primitives + primitive_start,
+                        m_primitives + primitive_end, get_bounds, split_axis) -
+        m_primitives;
 
     // add internal node
     const int parent_offset = m_nodes.size();
@@ -374,13 +365,33 @@ class BVHOptimized : public Intersector
     buildBVHNode(split_idx, primitive_end);
   }
 
+  // intersect bvh nodes from root
+  template <bool COUNT_NODES>
+  bool intersectRoot(const Ray& ray, IntersectInfo& info) const
+  {
+    // precompute inverse of ray direction, sign
+    const glm::vec3 dir_inv = 1.0f / ray.direction;
+    int dir_inv_sign[3];
+    for (int i = 0; i < 3; ++i) { dir_inv_sign[i] = dir_inv[i] > 0 ? 0 : 1; }
+
+    float ray_tmax = ray.tmax;
+    bool hit = intersectNode<COUNT_NODES>(0, ray, dir_inv, dir_inv_sign,
+                                          info);
+    ray.tmax = ray_tmax;
+    return hit;
+  }
+
   // traverse bvh nodes recursively
+  // visited nodes are counted in info.bvh_depth if COUNT_NODES
+  template <bool COUNT_NODES>
   bool intersectNode(int node_idx, const Ray& ray, const glm::vec3& dir_inv,
                      const int dir_inv_sign[3], IntersectInfo& info) const
   {
     bool hit = false;
     const BVHNode& node = m_nodes[node_idx];
 
+    if constexpr (COUNT_NODES) { info.bvh_depth++; }
+
     // intersect with bounding box
     if (node.bbox.intersect(ray, dir_inv, dir_inv_sign)) {
       if (node.n_primitives > 0) {
@@ -396,17 +407,42 @@ class BVHOptimized : public Intersector
       } else {
         // intersect with child nodes
         if (dir_inv_sign[node.axis] == 0) {
-          hit |= intersectNode(node_idx + 1, ray, dir_inv, dir_inv_sign, info);
-          hit |= intersectNode(node.second_child_offset, ray, dir_inv,
-                               dir_inv_sign, info);
+          hit |= intersectNode<COUNT_NODES>(node_idx + 1, ray, dir_inv,
+                                            dir_inv_sign, info);
+          hit |= intersectNode<COUNT_NODES>(node.second_child_offset, ray,
+                                            dir_inv, dir_inv_sign, info);
         } else {
-          hit |= intersectNode(node.second_child_offset, ray, dir_inv,
-                               dir_inv_sign, info);
-          hit |= intersectNode(node_idx + 1, ray, dir_inv, dir_inv_sign, info);
+          hit |= intersectNode<COUNT_NODES>(node.second_child_offset, ray,
+                                            dir_inv, dir_inv_sign, info);
+          hit |= intersectNode<COUNT_NODES>(node_idx + 1, ray, dir_inv,
+                                            dir_inv_sign, info);
         }
       }
     }
 
     return hit;
   }
+
+  // traverse bvh nodes recursively until any intersection is found
+  bool occludedNode(int node_idx, const Ray& ray, const glm::vec3& dir_inv,
+                    const int dir_inv_sign[3]) const
+  {
+    const BVHNode& node = m_nodes[node_idx];
+    if (!node.bbox.intersect(ray, dir_inv, dir_inv_sign)) { return false; }
+
+    if (node.n_primitives > 0) {
+      // when leaf node, intersect with primitives
+      IntersectInfo info;
+      const int primitive_end =
+          node.primitive_indices_offset + node.n_primitives;
+      for (int i = node.primitive_indices_offset; i < primitive_end; ++i) {
+        if (m_primitives[i].intersect(ray, info)) { return true; }
+      }
+      return false;
+    }
+
+    // intersect with child nodes
+    return occludedNode(node_idx + 1, ray, dir_inv, dir_inv_sign) ||
+           occludedNode(node.second_child_offset, ray, dir_inv, dir_inv_sign);
+  }
 };
\ No newline at end of file
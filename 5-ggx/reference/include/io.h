@@ -1,14 +1,34 @@
 #pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "deflate.h"
 #include "glm/glm.hpp"
+#include "postprocess.h"
 #include "stb_image_write.h"
 
-// output ppm image
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// zlib compressor of stb_image_write, which is defined in its implementation
+// but not declared in the header
+extern "C" unsigned char* stbi_zlib_compress(unsigned char* data, int data_len,
+                                             int* out_len, int quality);
+
+// output binary ppm(P6) image
+// pixels are converted in parallel into one buffer with header, which is
+// written at once
 // filename: output filename
 // width: width of output image
 // height: height of output image
@@ -16,27 +36,304 @@
 inline void write_ppm(const std::string& filename, int width, int height,
                       const float* image)
 {
-  std::ofstream file(filename);
+  const std::string header = "P6\n" + std::to_string(width) + " " +
+                             std::to_string(height) + "\n255\n";
+
+  std::vector<unsigned char> data(header.size() + 3 * width * height);
+  std::memcpy(data.data(), header.data(), header.size());
+  unsigned char* pixels = data.data() + header.size();
+#pragma omp parallel for
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < 3 * width; ++i) {
+      const int idx = i + 3 * width * j;
+      pixels[idx] = glm::clamp(static_cast<int>(255.0f * image[idx]), 0, 255);
+    }
+  }
+
+  std::ofstream file(filename, std::ios::binary);
   if (!file.is_open()) {
     throw std::runtime_error("failed to open " + filename);
   }
+  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  if (!file) { throw std::runtime_error("failed to write " + filename); }
+}
+
+// output 16 bit binary ppm(P6) image
+// samples are stored in big endian as required by the format
+// filename: output filename
+// width: width of output image
+// height: height of output image
+// image: image data
+inline void write_ppm16(const std::string& filename, int width, int height,
+                        const float* image)
+{
+  const std::string header = "P6\n" + std::to_string(width) + " " +
+                             std::to_string(height) + "\n65535\n";
 
-  file << "P3" << std::endl;
-  file << width << " " << height << std::endl;
-  file << "255" << std::endl;
+  std::vector<unsigned char> data(header.size() + 6 * width * height);
+  std::memcpy(data.data(), header.data(), header.size());
+  unsigned char* pixels = data.data() + header.size();
+#pragma omp parallel for
   for (int j = 0; j < height; ++j) {
-    for (int i = 0; i < width; ++i) {
-      const int idx = 3 * i + 3 * width * j;
-      const float R = image[idx];
-      const float G = image[idx + 1];
-      const float B = image[idx + 2];
-      file << glm::clamp(static_cast<int>(255.0f * R), 0, 255) << " "
-           << glm::clamp(static_cast<int>(255.0f * G), 0, 255) << " "
-           << glm::clamp(static_cast<int>(255.0f * B), 0, 255) << std::endl;
+    for (int i = 0; i < 3 * width; ++i) {
+      const int idx = i + 3 * width * j;
+      const int v =
+          glm::clamp(static_cast<int>(65535.0f * image[idx]), 0, 65535);
+      pixels[2 * idx] = v >> 8;
+      pixels[2 * idx + 1] = v & 0xff;
+    }
+  }
+
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open " + filename);
+  }
+  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  if (!file) { throw std::runtime_error("failed to write " + filename); }
+}
+
+// crc-32 of png chunk
+inline uint32_t crc32(const unsigned char* data, size_t size,
+                      uint32_t crc = 0)
+{
+  static const std::vector<uint32_t> table = []() {
+    std::vector<uint32_t> t(256);
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      }
+      t[n] = c;
+    }
+    return t;
+  }();
+
+  crc = ~crc;
+  for (size_t k = 0; k < size; ++k) {
+    crc = table[(crc ^ data[k]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+// filter one row of png with filter which minimizes sum of absolute values
+// prev_row: previous row, nullptr for first row
+// filtered: output, filter type followed by filtered bytes
+// scratch: work buffer reused between rows, which avoids allocation per row
+inline void filter_png_row(const unsigned char* row,
+                           const unsigned char* prev_row, int row_size,
+                           unsigned char* filtered,
+                           std::vector<unsigned char>& scratch)
+{
+  constexpr int BPP = 3;
+
+  // candidate row, followed by row of 0 which predicts first row
+  scratch.resize(2 * row_size);
+  unsigned char* candidate = scratch.data();
+  if (prev_row == nullptr) {
+    std::fill(scratch.begin() + row_size, scratch.end(), 0);
+    prev_row = scratch.data() + row_size;
+  }
+
+  // residual of filter type at k
+  // a, b, c: left, up and upper left bytes
+  const auto residual = [](int type, int x, int a, int b, int c) {
+    int predictor = 0;
+    if (type == 1) {
+      predictor = a;
+    } else if (type == 2) {
+      predictor = b;
+    } else if (type == 3) {
+      predictor = (a + b) / 2;
+    } else if (type == 4) {
+      // paeth predictor
+      const int p = a + b - c;
+      const int pa = glm::abs(p - a);
+      const int pb = glm::abs(p - b);
+      const int pc = glm::abs(p - c);
+      predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+    }
+    return static_cast<unsigned char>(x - predictor);
+  };
+
+  // filter row with each type, and keep the best one
+  uint64_t best_cost = UINT64_MAX;
+  for (int type = 0; type < 5; ++type) {
+    uint64_t cost = 0;
+    for (int k = 0; k < row_size; ++k) {
+      const int a = k >= BPP ? row[k - BPP] : 0;
+      const int c = k >= BPP ? prev_row[k - BPP] : 0;
+      candidate[k] = residual(type, row[k], a, prev_row[k], c);
+      const int v = static_cast<signed char>(candidate[k]);
+      cost += glm::abs(v);
+    }
+    if (cost < best_cost) {
+      best_cost = cost;
+      filtered[0] = type;
+      std::memcpy(filtered + 1, candidate, row_size);
     }
   }
+}
 
-  file.close();
+// make png chunk: length, type, data and crc
+inline std::vector<unsigned char> make_png_chunk(
+    const char* type, const std::vector<unsigned char>& data)
+{
+  const uint32_t length = data.size();
+  std::vector<unsigned char> chunk(12 + length);
+  for (int k = 0; k < 4; ++k) { chunk[k] = length >> (24 - 8 * k); }
+  std::memcpy(&chunk[4], type, 4);
+  std::copy(data.begin(), data.end(), chunk.begin() + 8);
+  const uint32_t crc = crc32(&chunk[4], 4 + length);
+  for (int k = 0; k < 4; ++k) { chunk[8 + length + k] = crc >> (24 - 8 * k); }
+  return chunk;
+}
+
+// make png signature and IHDR chunk of 8 bit RGB image
+inline std::vector<unsigned char> make_png_header(int width, int height)
+{
+  std::vector<unsigned char> ihdr(13);
+  for (int k = 0; k < 4; ++k) {
+    ihdr[k] = width >> (24 - 8 * k);
+    ihdr[4 + k] = height >> (24 - 8 * k);
+  }
+  ihdr[8] = 8;  // bit depth
+  ihdr[9] = 2;  // color type RGB
+  // compression, filter and interlace methods are all 0
+
+  std::vector<unsigned char> header = {0x89, 'P',  'N', 'G',
+                                       '\r', '\n', 0x1a, '\n'};
+  const std::vector<unsigned char> chunk = make_png_chunk("IHDR", ihdr);
+  header.insert(header.end(), chunk.begin(), chunk.end());
+  return header;
+}
+
+// filter and deflate rows of 8 bit RGB into IDAT chunks
+// rows are split into blocks, which are filtered and deflated in parallel.
+// each block is its own IDAT chunk, and deflate blocks are byte aligned by
+// sync flush, so that chunks of consecutive calls form one zlib stream.
+// rows: image data of n_rows rows(RGB, 8 bit)
+// prev_row: row before rows, nullptr if rows start image. zlib header is
+// added to first chunk in that case.
+// final: if true, last block ends deflate stream
+// adler: adler-32 of filtered data is combined into this
+inline std::vector<std::vector<unsigned char>> make_png_idat_chunks(
+    const unsigned char* rows, const unsigned char* prev_row, int width,
+    int n_rows, int compression_level, bool final, uint32_t& adler)
+{
+  // size of data per block, which is large enough for compression while
+  // giving enough blocks to threads
+  constexpr size_t BLOCK_SIZE = 1 << 19;
+
+  const size_t row_size = 3 * static_cast<size_t>(width);
+  const int rows_per_block =
+      glm::max(1, static_cast<int>(BLOCK_SIZE / (row_size + 1)));
+  const int n_blocks = (n_rows + rows_per_block - 1) / rows_per_block;
+
+  std::vector<std::vector<unsigned char>> chunks(n_blocks);
+  std::vector<uint32_t> adlers(n_blocks);
+  std::vector<size_t> sizes(n_blocks);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int b = 0; b < n_blocks; ++b) {
+    const int y0 = b * rows_per_block;
+    const int y1 = glm::min(y0 + rows_per_block, n_rows);
+
+    std::vector<unsigned char> filtered((row_size + 1) * (y1 - y0));
+    std::vector<unsigned char> scratch;
+    for (int j = y0; j < y1; ++j) {
+      filter_png_row(rows + row_size * j,
+                     j > 0 ? rows + row_size * (j - 1) : prev_row, row_size,
+                     &filtered[(row_size + 1) * (j - y0)], scratch);
+    }
+    adlers[b] = adler32(filtered.data(), filtered.size());
+    sizes[b] = filtered.size();
+
+    std::vector<unsigned char> data;
+    // zlib header
+    if (b == 0 && prev_row == nullptr) { data = {0x78, 0x01}; }
+    deflate(filtered.data(), filtered.size(), compression_level,
+            final && b == n_blocks - 1, data);
+    chunks[b] = make_png_chunk("IDAT", data);
+  }
+
+  for (int b = 0; b < n_blocks; ++b) {
+    adler = adler32_combine(adler, adlers[b], sizes[b]);
+  }
+  return chunks;
+}
+
+// make IDAT chunk of adler-32, which ends zlib stream
+// end_stream: if true, empty final deflate block is added before adler-32,
+// which is needed when last IDAT chunk didn't end deflate stream
+inline std::vector<unsigned char> make_png_trailer(uint32_t adler,
+                                                   bool end_stream)
+{
+  std::vector<unsigned char> data;
+  // empty stored block with final bit
+  if (end_stream) { data = {0x01, 0x00, 0x00, 0xff, 0xff}; }
+  for (int k = 0; k < 4; ++k) { data.push_back(adler >> (24 - 8 * k)); }
+  return make_png_chunk("IDAT", data);
+}
+
+// output png image of 8 bit RGB
+// image is compressed in parallel, see make_png_idat_chunks. it is faster than
+// stb_image_write with many threads, while it is slower with one thread.
+// filename: output filename
+// width: width of output image
+// height: height of output image
+// image: image data(RGB, 8 bit)
+// compression_level: 0(store) to 9(best)
+inline void write_png_rgb8(const std::string& filename, int width, int height,
+                           const unsigned char* image,
+                           int compression_level = 6)
+{
+  uint32_t adler = 1;
+  const std::vector<std::vector<unsigned char>> chunks = make_png_idat_chunks(
+      image, nullptr, width, height, compression_level, true, adler);
+
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open " + filename);
+  }
+  const auto write = [&](const std::vector<unsigned char>& data) {
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  };
+  write(make_png_header(width, height));
+  for (const auto& chunk : chunks) { write(chunk); }
+  write(make_png_trailer(adler, false));
+  write(make_png_chunk("IEND", {}));
+
+  if (!file) { throw std::runtime_error("failed to write " + filename); }
+}
+
+// minimum number of pixels of image encoded by write_png_rgb8 in write_png
+// smaller image isn't worth splitting into blocks
+constexpr int PARALLEL_PNG_MIN_PIXELS = 1 << 20;
+
+// output png image of 8 bit RGB with encoder suited to image
+// large image is encoded by write_png_rgb8 when several threads are
+// available, and others by stb_image_write
+// compression_level: 0(store) to 9(best), used by write_png_rgb8 only
+inline void write_png_data(const std::string& filename, int width, int height,
+                           const unsigned char* data, int compression_level)
+{
+  int n_threads = 1;
+#ifdef _OPENMP
+  n_threads = omp_get_max_threads();
+#endif
+  if (n_threads > 1 &&
+      static_cast<int64_t>(width) * height >= PARALLEL_PNG_MIN_PIXELS) {
+    try {
+      write_png_rgb8(filename, width, height, data, compression_level);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+    }
+    return;
+  }
+
+  if (!stbi_write_png(filename.c_str(), width, height, 3, data,
+                      3 * width * sizeof(unsigned char))) {
+    std::cerr << "failed to save " << filename << std::endl;
+  }
 }
 
 // output png image
@@ -44,11 +341,13 @@ inline void write_ppm(const std::string& filename, int width, int height,
 // width: width of output image
 // height: height of output image
 // image: image data
+// compression_level: 0(store) to 9(best) of parallel encoder
 inline void write_png(const std::string& filename, int width, int height,
-                      const float* image)
+                      const float* image, int compression_level = 6)
 {
   // convert float to unsigned char
   std::vector<unsigned char> data(3 * width * height);
+#pragma omp parallel for
   for (int j = 0; j < height; ++j) {
     for (int i = 0; i < width; ++i) {
       const int idx = 3 * i + 3 * width * j;
@@ -60,8 +359,505 @@ inline void write_png(const std::string& filename, int width, int height,
     }
   }
 
-  if (!stbi_write_png(filename.c_str(), width, height, 3, data.data(),
-                      3 * width * sizeof(unsigned char))) {
-    std::cerr << "failed to save " << filename << std::endl;
+  write_png_data(filename, width, height, data.data(), compression_level);
+}
+
+// output png image of linear radiance
+// post processing is fused with conversion to unsigned char, so that image
+// is read only once
+// filename: output filename
+// width: width of output image
+// height: height of output image
+// image: image data(linear RGB)
+// post_process: exposure and tone mapping
+// compression_level: 0(store) to 9(best) of parallel encoder
+inline void write_png(const std::string& filename, int width, int height,
+                      const float* image, const PostProcess& post_process,
+                      int compression_level = 6)
+{
+  std::vector<unsigned char> data(3 * width * height);
+  post_process.apply(image, width, height, data.data());
+
+  write_png_data(filename, width, height, data.data(), compression_level);
+}
+
+// output pfm image
+// rows are written from bottom to top directly from image data
+// filename: output filename
+// width: width of output image
+// height: height of output image
+// image: image data(linear RGB)
+inline void write_pfm(const std::string& filename, int width, int height,
+                      const float* image)
+{
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open " + filename);
+  }
+
+  // negative scale means little endian
+  file << "PF\n" << width << " " << height << "\n-1.0\n";
+  for (int j = height - 1; j >= 0; --j) {
+    file.write(reinterpret_cast<const char*>(image + 3 * width * j),
+               3 * width * sizeof(float));
+  }
+
+  if (!file) { throw std::runtime_error("failed to write " + filename); }
+}
+
+// compression of exr image
+enum class ExrCompression {
+  NONE,  // uncompressed
+  ZIP,   // zlib compression of 16 scanlines
+};
+
+// number of scanlines in one chunk of exr
+inline int exr_lines_per_chunk(ExrCompression compression)
+{
+  return compression == ExrCompression::ZIP ? 16 : 1;
+}
+
+// make one chunk of scanline exr, which contains scanlines [y0, y1)
+// channels are stored in alphabetical order(B, G, R) in each scanline
+// rows: image data of scanlines [y0, y1)(linear RGB)
+inline std::vector<unsigned char> make_exr_chunk(int width, int y0, int y1,
+                                                 const float* rows,
+                                                 ExrCompression compression)
+{
+  // planar scanlines
+  std::vector<float> planar(3 * width * (y1 - y0));
+  for (int j = 0; j < y1 - y0; ++j) {
+    float* line = &planar[3 * width * j];
+    for (int i = 0; i < width; ++i) {
+      const int idx = 3 * i + 3 * width * j;
+      line[i] = rows[idx + 2];
+      line[width + i] = rows[idx + 1];
+      line[2 * width + i] = rows[idx];
+    }
+  }
+  const unsigned char* raw = reinterpret_cast<unsigned char*>(planar.data());
+  const int raw_size = planar.size() * sizeof(float);
+
+  std::vector<unsigned char> data;
+  if (compression == ExrCompression::ZIP) {
+    // split even and odd bytes, and take difference of neighboring bytes
+    std::vector<unsigned char> predicted(raw_size);
+    const int half = (raw_size + 1) / 2;
+    for (int k = 0; k < raw_size; ++k) {
+      predicted[(k % 2 == 0) ? k / 2 : half + k / 2] = raw[k];
+    }
+    for (int k = raw_size - 1; k > 0; --k) {
+      predicted[k] = predicted[k] - predicted[k - 1] + 128;
+    }
+
+    int compressed_size = 0;
+    unsigned char* compressed =
+        stbi_zlib_compress(predicted.data(), raw_size, &compressed_size, 8);
+    // store uncompressed data when compression doesn't reduce size
+    if (compressed != nullptr && compressed_size < raw_size) {
+      data.assign(compressed, compressed + compressed_size);
+    }
+    std::free(compressed);
+  }
+  if (data.empty()) { data.assign(raw, raw + raw_size); }
+
+  // chunk header: y coordinate and size of data
+  std::vector<unsigned char> chunk(8 + data.size());
+  const int32_t header[2] = {y0, static_cast<int32_t>(data.size())};
+  std::memcpy(chunk.data(), header, sizeof(header));
+  std::memcpy(chunk.data() + 8, data.data(), data.size());
+  return chunk;
+}
+
+// make header of single part scanline exr image with float channels
+inline std::string make_exr_header(int width, int height,
+                                   ExrCompression compression)
+{
+  std::string header;
+  const auto put = [&](const void* data, size_t size) {
+    header.append(reinterpret_cast<const char*>(data), size);
+  };
+  const auto put_i32 = [&](int32_t v) { put(&v, sizeof(v)); };
+  const auto put_f32 = [&](float v) { put(&v, sizeof(v)); };
+  const auto put_attribute = [&](const char* name, const char* type,
+                                 int32_t size) {
+    put(name, std::strlen(name) + 1);
+    put(type, std::strlen(type) + 1);
+    put_i32(size);
+  };
+
+  // magic number, version 2 with single part scanline flags
+  put_i32(20000630);
+  put_i32(2);
+
+  put_attribute("channels", "chlist", 3 * 18 + 1);
+  for (const char* name : {"B", "G", "R"}) {
+    put(name, 2);
+    put_i32(2);  // FLOAT
+    put_i32(0);  // pLinear and reserved
+    put_i32(1);  // x sampling
+    put_i32(1);  // y sampling
+  }
+  header.push_back('\0');
+
+  put_attribute("compression", "compression", 1);
+  header.push_back(compression == ExrCompression::ZIP ? 3 : 0);
+
+  for (const char* name : {"dataWindow", "displayWindow"}) {
+    put_attribute(name, "box2i", 16);
+    put_i32(0);
+    put_i32(0);
+    put_i32(width - 1);
+    put_i32(height - 1);
+  }
+
+  put_attribute("lineOrder", "lineOrder", 1);
+  header.push_back(0);  // increasing y
+
+  put_attribute("pixelAspectRatio", "float", 4);
+  put_f32(1.0f);
+
+  put_attribute("screenWindowCenter", "v2f", 8);
+  put_f32(0.0f);
+  put_f32(0.0f);
+
+  put_attribute("screenWindowWidth", "float", 4);
+  put_f32(1.0f);
+
+  header.push_back('\0');
+  return header;
+}
+
+// output single part scanline exr image with float channels
+// chunks are converted and compressed in parallel
+// filename: output filename
+// width: width of output image
+// height: height of output image
+// image: image data(linear RGB)
+inline void write_exr(const std::string& filename, int width, int height,
+                      const float* image,
+                      ExrCompression compression = ExrCompression::ZIP)
+{
+  const int lines_per_chunk = exr_lines_per_chunk(compression);
+  const int n_chunks = (height + lines_per_chunk - 1) / lines_per_chunk;
+
+  std::vector<std::vector<unsigned char>> chunks(n_chunks);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int c = 0; c < n_chunks; ++c) {
+    const int y0 = c * lines_per_chunk;
+    const int y1 = glm::min(y0 + lines_per_chunk, height);
+    chunks[c] = make_exr_chunk(width, y0, y1, image + 3 * width * y0,
+                               compression);
+  }
+
+  const std::string header = make_exr_header(width, height, compression);
+
+  // offset table
+  std::vector<uint64_t> offsets(n_chunks);
+  uint64_t offset = header.size() + n_chunks * sizeof(uint64_t);
+  for (int c = 0; c < n_chunks; ++c) {
+    offsets[c] = offset;
+    offset += chunks[c].size();
+  }
+
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open " + filename);
+  }
+  file.write(header.data(), header.size());
+  file.write(reinterpret_cast<const char*>(offsets.data()),
+             offsets.size() * sizeof(uint64_t));
+  for (const auto& chunk : chunks) {
+    file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+  }
+
+  if (!file) { throw std::runtime_error("failed to write " + filename); }
+}
+
+// input pfm image(PF or Pf)
+// rows are converted from bottom to top order, and gray image is expanded to
+// RGB
+// filename: input filename
+// width: width of input image
+// height: height of input image
+// return: image data(linear RGB)
+inline std::vector<float> read_pfm(const std::string& filename, int& width,
+                                   int& height)
+{
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open " + filename);
+  }
+
+  std::string magic;
+  float scale;
+  file >> magic >> width >> height >> scale;
+  file.get();  // single whitespace after header
+  if (!file || (magic != "PF" && magic != "Pf") || width <= 0 ||
+      height <= 0) {
+    throw std::runtime_error("invalid pfm header of " + filename);
+  }
+  const int n_channels = magic == "PF" ? 3 : 1;
+
+  std::vector<float> data(n_channels * width * height);
+  file.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(float));
+  if (!file) { throw std::runtime_error("failed to read " + filename); }
+
+  // positive scale means big endian
+  if (scale > 0.0f) {
+    for (float& v : data) {
+      uint32_t bits;
+      std::memcpy(&bits, &v, sizeof(bits));
+      bits = (bits >> 24) | ((bits >> 8) & 0xff00) | ((bits << 8) & 0xff0000) |
+             (bits << 24);
+      std::memcpy(&v, &bits, sizeof(bits));
+    }
+  }
+
+  std::vector<float> image(3 * width * height);
+  for (int j = 0; j < height; ++j) {
+    const float* row = &data[n_channels * width * (height - 1 - j)];
+    for (int i = 0; i < width; ++i) {
+      for (int c = 0; c < 3; ++c) {
+        image[3 * (i + width * j) + c] = row[n_channels * i + c % n_channels];
+      }
+    }
+  }
+  return image;
+}
+
+// convert IEEE 754 half to float
+inline float half_to_float(uint16_t h)
+{
+  const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+  const uint32_t exponent = (h >> 10) & 0x1f;
+  const uint32_t mantissa = h & 0x3ff;
+
+  // zero or subnormal
+  if (exponent == 0) {
+    const float v = std::ldexp(static_cast<float>(mantissa), -24);
+    return sign ? -v : v;
+  }
+
+  // infinity or NaN keep their mantissa, others are rebiased
+  const uint32_t bits =
+      exponent == 31 ? sign | 0x7f800000 | (mantissa << 13)
+                     : sign | ((exponent + 112) << 23) | (mantissa << 13);
+  float f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+// input single part scanline exr image
+// R, G and B channels of half or float are read, and image with only Y
+// channel is read as gray. compression must be none, ZIPS or ZIP, which
+// covers images written by write_exr. chunks are decompressed in parallel.
+// filename: input filename
+// width: width of input image
+// height: height of input image
+// return: image data(linear RGB)
+inline std::vector<float> read_exr(const std::string& filename, int& width,
+                                   int& height)
+{
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open " + filename);
+  }
+  const std::vector<unsigned char> bytes(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  size_t position = 0;
+  const auto read = [&](void* data, size_t size) {
+    if (position + size > bytes.size()) {
+      throw std::runtime_error("unexpected end of " + filename);
+    }
+    std::memcpy(data, &bytes[position], size);
+    position += size;
+  };
+  const auto read_i32 = [&]() {
+    int32_t v;
+    read(&v, sizeof(v));
+    return v;
+  };
+  const auto read_string = [&]() {
+    std::string str;
+    char c;
+    while (read(&c, 1), c != '\0') { str.push_back(c); }
+    return str;
+  };
+
+  // magic number, version 2 without tiled, deep and multi part flags
+  if (read_i32() != 20000630) {
+    throw std::runtime_error("not exr file " + filename);
+  }
+  const int32_t version = read_i32();
+  if ((version & 0xff) != 2 || (version & 0x1a00) != 0) {
+    throw std::runtime_error("unsupported exr version of " + filename);
+  }
+
+  // attributes
+  struct Channel {
+    std::string name;
+    int32_t type;  // 1: HALF, 2: FLOAT
+  };
+  std::vector<Channel> channels;
+  int compression = -1;
+  int32_t window[4] = {0, 0, -1, -1};  // x_min, y_min, x_max, y_max
+  while (true) {
+    const std::string name = read_string();
+    if (name.empty()) { break; }
+    read_string();  // type
+    const int32_t size = read_i32();
+    const size_t end = position + size;
+
+    if (name == "channels") {
+      while (true) {
+        const std::string channel = read_string();
+        if (channel.empty()) { break; }
+        const int32_t type = read_i32();
+        int32_t rest[3];  // pLinear and reserved, x and y sampling
+        read(rest, sizeof(rest));
+        if ((type != 1 && type != 2) || rest[1] != 1 || rest[2] != 1) {
+          throw std::runtime_error("unsupported exr channel " + channel);
+        }
+        channels.push_back({channel, type});
+      }
+    } else if (name == "compression") {
+      uint8_t c;
+      read(&c, 1);
+      compression = c;
+    } else if (name == "dataWindow") {
+      read(window, sizeof(window));
+    }
+    position = end;
+  }
+
+  width = window[2] - window[0] + 1;
+  height = window[3] - window[1] + 1;
+  if (width <= 0 || height <= 0) {
+    throw std::runtime_error("invalid data window of " + filename);
+  }
+
+  // 0: NONE, 2: ZIPS(1 scanline), 3: ZIP(16 scanlines)
+  if (compression != 0 && compression != 2 && compression != 3) {
+    throw std::runtime_error("unsupported exr compression of " + filename);
+  }
+  const int lines_per_chunk = compression == 3 ? 16 : 1;
+
+  // byte offset of R, G, B channels in scanline, Y is used for missing RGB
+  int offsets[3] = {-1, -1, -1};
+  int types[3] = {0, 0, 0};
+  int line_size = 0;
+  for (const Channel& channel : channels) {
+    for (int c = 0; c < 3; ++c) {
+      if (channel.name == std::string(1, "RGB"[c]) ||
+          (channel.name == "Y" && offsets[c] < 0)) {
+        offsets[c] = line_size;
+        types[c] = channel.type;
+      }
+    }
+    line_size += width * (channel.type == 1 ? 2 : 4);
+  }
+  for (int c = 0; c < 3; ++c) {
+    if (offsets[c] < 0) {
+      throw std::runtime_error("missing RGB channels in " + filename);
+    }
+  }
+
+  const int n_chunks = (height + lines_per_chunk - 1) / lines_per_chunk;
+  std::vector<uint64_t> chunk_offsets(n_chunks);
+  read(chunk_offsets.data(), n_chunks * sizeof(uint64_t));
+
+  std::vector<float> image(3 * width * height);
+  std::vector<std::string> errors(n_chunks);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int k = 0; k < n_chunks; ++k) {
+    try {
+      // chunk header: y coordinate and size of data
+      const uint64_t offset = chunk_offsets[k];
+      int32_t header[2];
+      if (offset + sizeof(header) > bytes.size()) {
+        throw std::runtime_error("invalid chunk offset");
+      }
+      std::memcpy(header, &bytes[offset], sizeof(header));
+      const int y0 = header[0] - window[1];
+      const int y1 = glm::min(y0 + lines_per_chunk, height);
+      const size_t raw_size = static_cast<size_t>(line_size) * (y1 - y0);
+      if (y0 < 0 || y0 >= height || header[1] < 0 ||
+          offset + sizeof(header) + header[1] > bytes.size()) {
+        throw std::runtime_error("invalid chunk");
+      }
+      const unsigned char* data = &bytes[offset + sizeof(header)];
+
+      // data is stored uncompressed when compression doesn't reduce size
+      std::vector<unsigned char> raw;
+      if (compression != 0 && static_cast<size_t>(header[1]) < raw_size) {
+        const std::vector<unsigned char> predicted =
+            zlib_decompress(data, header[1]);
+        if (predicted.size() != raw_size) {
+          throw std::runtime_error("invalid size of chunk");
+        }
+
+        // undo difference of neighboring bytes, and interleave even and odd
+        // bytes
+        std::vector<unsigned char> split(predicted);
+        for (size_t b = 1; b < raw_size; ++b) {
+          split[b] = split[b - 1] + split[b] - 128;
+        }
+        const size_t half = (raw_size + 1) / 2;
+        raw.resize(raw_size);
+        for (size_t b = 0; b < raw_size; ++b) {
+          raw[b] = split[(b % 2 == 0) ? b / 2 : half + b / 2];
+        }
+      } else {
+        raw.assign(data, data + header[1]);
+      }
+      if (raw.size() != raw_size) {
+        throw std::runtime_error("invalid size of chunk");
+      }
+
+      for (int j = y0; j < y1; ++j) {
+        const unsigned char* line = &raw[line_size * (j - y0)];
+        for (int c = 0; c < 3; ++c) {
+          for (int i = 0; i < width; ++i) {
+            float v;
+            if (types[c] == 1) {
+              uint16_t h;
+              std::memcpy(&h, line + offsets[c] + 2 * i, sizeof(h));
+              v = half_to_float(h);
+            } else {
+              std::memcpy(&v, line + offsets[c] + 4 * i, sizeof(v));
+            }
+            image[3 * (i + width * j) + c] = v;
+          }
+        }
+      }
+    } catch (const std::exception& e) {
+      errors[k] = e.what();
+    }
+  }
+  for (const std::string& error : errors) {
+    if (!error.empty()) {
+      throw std::runtime_error(error + " in " + filename);
+    }
+  }
+
+  return image;
+}
+
+// input image of format chosen by extension(.exr or .pfm)
+// filename: input filename
+// width: width of input image
+// height: height of input image
+// return: image data(linear RGB)
+inline std::vector<float> read_image(const std::string& filename, int& width,
+                                     int& height)
+{
+  const std::string extension = std::filesystem::path(filename).extension();
+  if (extension == ".exr") {
+    return read_exr(filename, width, height);
+  } else if (extension == ".pfm") {
+    return read_pfm(filename, width, height);
   }
+  throw std::runtime_error("unsupported format " + filename);
 }
\ No newline at end of file
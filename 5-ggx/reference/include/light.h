@@ -0,0 +1,406 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#include "aabb.h"
+#include "core.h"
+#include "glm/glm.hpp"
+#include "sampler.h"
+#include "shape.h"
+#include "spdlog/spdlog.h"
+
+// area light attached to emissive shape
+class AreaLight
+{
+ public:
+  AreaLight(const Shape* shape, const glm::vec3& le) : m_shape(shape), m_le(le)
+  {
+  }
+
+  // light shape
+  const Shape* shape() const { return m_shape; }
+
+  // emitted radiance
+  glm::vec3 Le() const { return m_le; }
+
+  // emitted power
+  float power() const { return M_PIf * m_shape->area() * luminance(m_le); }
+
+  // sample point on light
+  // u: [0, 1] x [0, 1] random number
+  // normal: surface normal at sampled point
+  // pdf: pdf value(area measure)
+  // return: sampled position
+  glm::vec3 samplePoint(const glm::vec2& u, glm::vec3& normal,
+                        float& pdf) const
+  {
+    return m_shape->samplePoint(u, normal, pdf);
+  }
+
+ private:
+  const Shape* m_shape;  // light shape
+  glm::vec3 m_le;        // emitted radiance
+};
+
+class LightSampler
+{
+ public:
+  // select light to sample
+  // p: shading position
+  // u: [0, 1] random number
+  // pmf: probability of selecting returned light
+  // return: selected light, nullptr if there is no light
+  virtual const AreaLight* sample(const glm::vec3& p, float u,
+                                  float& pmf) const = 0;
+
+  // probability of selecting light attached to given shape
+  // p: shading position
+  // shape: shape of light, 0 is returned if it is not a light
+  virtual float pmf(const glm::vec3& p, const Shape* shape) const = 0;
+};
+
+// select light with probability proportional to its power
+class PowerLightSampler : public LightSampler
+{
+ public:
+  PowerLightSampler(const AreaLight* lights, uint32_t n_lights)
+      : m_lights(lights), m_n_lights(n_lights)
+  {
+    std::vector<float> power(m_n_lights);
+    for (uint32_t i = 0; i < m_n_lights; ++i) {
+      power[i] = m_lights[i].power();
+      m_light_indices[m_lights[i].shape()] = i;
+    }
+    if (m_n_lights > 0) {
+      m_distribution = DiscreteDistribution1D(power.data(), m_n_lights);
+    }
+  }
+
+  const AreaLight* sample(const glm::vec3& p, float u,
+                          float& pmf) const override
+  {
+    if (m_n_lights == 0) { return nullptr; }
+    return &m_lights[m_distribution.sample(u, pmf)];
+  }
+
+  float pmf(const glm::vec3& p, const Shape* shape) const override
+  {
+    const auto it = m_light_indices.find(shape);
+    if (it == m_light_indices.end()) { return 0.0f; }
+    return m_distribution.pmf(it->second);
+  }
+
+ private:
+  const AreaLight* m_lights;  // array of lights
+  uint32_t m_n_lights;        // number of lights
+
+  DiscreteDistribution1D m_distribution;  // distribution of light power
+  std::unordered_map<const Shape*, uint32_t>
+      m_light_indices;  // light index of each shape
+};
+
+// bounding cone of light directions
+// emission is two-sided, so the cone also covers directions around -axis
+struct LightCone {
+  glm::vec3 axis = glm::vec3(0, 1, 0);  // axis of cone
+  float theta = 0.0f;                   // half angle of cone
+
+  // merge two cones
+  // Conty Estevez, A., & Kulla, C. (2018). Importance sampling of many lights
+  // with adaptive tree splitting.
+  LightCone mergeCone(const LightCone& c) const
+  {
+    LightCone a = *this;
+    LightCone b = c;
+    if (b.theta > a.theta) { std::swap(a, b); }
+
+    // flip axis, since emission is two-sided
+    if (glm::dot(a.axis, b.axis) < 0.0f) { b.axis = -b.axis; }
+
+    const float theta_d =
+        glm::acos(glm::clamp(glm::dot(a.axis, b.axis), -1.0f, 1.0f));
+    if (glm::min(theta_d + b.theta, M_PIf) <= a.theta) { return a; }
+
+    LightCone ret;
+    ret.theta = 0.5f * (a.theta + theta_d + b.theta);
+    if (ret.theta >= M_PIf) {
+      ret.axis = a.axis;
+      ret.theta = M_PIf;
+      return ret;
+    }
+
+    // rotate a.axis toward b.axis
+    const float theta_r = ret.theta - a.theta;
+    const glm::vec3 w = b.axis - glm::dot(a.axis, b.axis) * a.axis;
+    const float w_length = glm::length(w);
+    ret.axis = w_length > 0.0f ? glm::normalize(glm::cos(theta_r) * a.axis +
+                                                glm::sin(theta_r) * w / w_length)
+                               : a.axis;
+    return ret;
+  }
+};
+
+// light bounding volume hierarchy
+// lights are selected by traversing the tree stochastically with probability
+// proportional to importance of each node, which is estimated from its
+// bounds, power and normal cone.
+// O(log(N))
+// Conty Estevez, A., & Kulla, C. (2018). Importance sampling of many lights
+// with adaptive tree splitting.
+class LightBVH : public LightSampler
+{
+ public:
+  LightBVH(const AreaLight* lights, uint32_t n_lights)
+      : m_lights(lights), m_n_lights(n_lights)
+  {
+  }
+
+  // build bvh nodes
+  void buildBVH()
+  {
+    m_nodes.clear();
+    m_leaf_lights.clear();
+    m_light_paths.assign(m_n_lights, 0);
+    m_light_indices.clear();
+
+    std::vector<BVHLight> bvh_lights(m_n_lights);
+    for (uint32_t i = 0; i < m_n_lights; ++i) {
+      const Shape* shape = m_lights[i].shape();
+      bvh_lights[i].bbox = shape->getBounds();
+      shape->getNormalBounds(bvh_lights[i].cone.axis,
+                             bvh_lights[i].cone.theta);
+      bvh_lights[i].power = m_lights[i].power();
+      bvh_lights[i].light_index = i;
+      m_light_indices[shape] = i;
+    }
+
+    // build bvh nodes from root
+    if (m_n_lights > 0) { buildBVHNode(bvh_lights, 0, m_n_lights, 0, 0); }
+
+    spdlog::info("[LightBVH] number of lights: {}", m_n_lights);
+    spdlog::info("[LightBVH] number of nodes: {}", m_nodes.size());
+  }
+
+  const AreaLight* sample(const glm::vec3& p, float u,
+                          float& pmf) const override
+  {
+    pmf = 0.0f;
+    if (m_nodes.empty()) { return nullptr; }
+
+    int node_idx = 0;
+    float prob = 1.0f;
+    while (m_nodes[node_idx].n_lights == 0) {
+      const int first = node_idx + 1;
+      const int second = m_nodes[node_idx].second_child_offset;
+      const float first_prob = firstChildProb(p, first, second);
+      if (first_prob < 0.0f) { return nullptr; }
+
+      // select child, and reuse u for the next selection
+      if (u < first_prob) {
+        u = glm::min(u / first_prob, ONE_MINUS_EPS);
+        prob *= first_prob;
+        node_idx = first;
+      } else {
+        u = glm::min((u - first_prob) / (1.0f - first_prob), ONE_MINUS_EPS);
+        prob *= 1.0f - first_prob;
+        node_idx = second;
+      }
+    }
+
+    // select light of leaf with probability proportional to its power
+    const BVHNode& leaf = m_nodes[node_idx];
+    uint32_t k = 0;
+    if (leaf.power <= 0.0f) {
+      k = glm::min(static_cast<uint32_t>(u * leaf.n_lights), leaf.n_lights - 1);
+    } else {
+      float u_power = u * leaf.power;
+      for (; k + 1 < leaf.n_lights; ++k) {
+        const float power = leafLightPower(leaf, k);
+        if (u_power < power) { break; }
+        u_power -= power;
+      }
+    }
+
+    pmf = prob * leafLightProb(leaf, k);
+    return &m_lights[m_leaf_lights[leaf.light_offset + k]];
+  }
+
+  float pmf(const glm::vec3& p, const Shape* shape) const override
+  {
+    const auto it = m_light_indices.find(shape);
+    if (it == m_light_indices.end()) { return 0.0f; }
+
+    // follow path from root to the leaf of the light
+    const uint64_t path = m_light_paths[it->second];
+    int node_idx = 0;
+    float prob = 1.0f;
+    for (int depth = 0; m_nodes[node_idx].n_lights == 0; ++depth) {
+      const int first = node_idx + 1;
+      const int second = m_nodes[node_idx].second_child_offset;
+      const float first_prob = firstChildProb(p, first, second);
+      if (first_prob < 0.0f) { return 0.0f; }
+
+      if ((path >> depth) & 1) {
+        prob *= 1.0f - first_prob;
+        node_idx = second;
+      } else {
+        prob *= first_prob;
+        node_idx = first;
+      }
+    }
+
+    // find light in leaf
+    const BVHNode& leaf = m_nodes[node_idx];
+    for (uint32_t k = 0; k < leaf.n_lights; ++k) {
+      if (m_leaf_lights[leaf.light_offset + k] == it->second) {
+        return prob * leafLightProb(leaf, k);
+      }
+    }
+    return 0.0f;
+  }
+
+ private:
+  static constexpr float ONE_MINUS_EPS = 0x1.fffffep-1f;
+
+  // max depth of tree, limited by bits of light path
+  static constexpr int MAX_DEPTH = 64;
+
+  struct BVHLight {
+    AABB bbox;             // bounding box
+    LightCone cone;        // normal cone
+    float power;           // emitted power
+    uint32_t light_index;  // index of light
+  };
+
+  struct BVHNode {
+    AABB bbox;       // bounding box
+    LightCone cone;  // normal cone
+    float power;     // sum of emitted power
+    union {
+      uint32_t light_offset;         // offset to lights of leaf
+      uint32_t second_child_offset;  // offset to second child node
+    };
+    // number of lights(0 means internal node)
+    // leaf has one light except at max depth
+    uint32_t n_lights;
+  };
+
+  const AreaLight* m_lights;  // array of lights
+  uint32_t m_n_lights;        // number of lights
+
+  std::vector<BVHNode> m_nodes;
+  std::vector<uint32_t> m_leaf_lights;  // light indices of leaves
+  std::vector<uint64_t> m_light_paths;  // child selections from root to leaf
+  std::unordered_map<const Shape*, uint32_t>
+      m_light_indices;  // light index of each shape
+
+  // build bvh nodes from root to leaves recursively
+  // path: child selections from root to this node(1 means second child)
+  void buildBVHNode(std::vector<BVHLight>& lights, int light_start,
+                    int light_end, uint64_t path, int depth)
+  {
+    const auto first = lights.begin() + light_start;
+    const auto last = lights.begin() + light_end;
+    const auto get_bounds = [](const BVHLight& light) { return light.bbox; };
+
+    // calculate bounds, cone, power
+    BVHNode node;
+    node.bbox = merge_bounds(first, last, get_bounds);
+    node.cone = lights[light_start].cone;
+    node.power = lights[light_start].power;
+    for (int i = light_start + 1; i < light_end; ++i) {
+      node.cone = node.cone.mergeCone(lights[i].cone);
+      node.power += lights[i].power;
+    }
+
+    // create leaf node, which keeps all remaining lights at max depth
+    const int n_lights = light_end - light_start;
+    if (n_lights == 1 || depth == MAX_DEPTH) {
+      node.light_offset = m_leaf_lights.size();
+      node.n_lights = n_lights;
+      for (int i = light_start; i < light_end; ++i) {
+        m_leaf_lights.push_back(lights[i].light_index);
+        m_light_paths[lights[i].light_index] = path;
+      }
+      m_nodes.push_back(node);
+      return;
+    }
+
+    // split at median of light centers
+    int split_axis;
+    const int split_idx =
+        split_at_median(first, last, get_bounds, split_axis) - lights.begin();
+
+    // add internal node
+    const int parent_offset = m_nodes.size();
+    node.n_lights = 0;
+    m_nodes.push_back(node);
+
+    // build left child nodes
+    buildBVHNode(lights, light_start, split_idx, path, depth + 1);
+
+    // calculate offset to right child node
+    m_nodes[parent_offset].second_child_offset = m_nodes.size();
+
+    // build right child nodes
+    buildBVHNode(lights, split_idx, light_end,
+                 path | (uint64_t(1) << depth), depth + 1);
+  }
+
+  // power of k-th light of leaf
+  float leafLightPower(const BVHNode& leaf, uint32_t k) const
+  {
+    return m_lights[m_leaf_lights[leaf.light_offset + k]].power();
+  }
+
+  // probability of selecting k-th light of leaf, which is proportional to
+  // its power, or uniform if leaf has no power
+  float leafLightProb(const BVHNode& leaf, uint32_t k) const
+  {
+    if (leaf.n_lights == 1) { return 1.0f; }
+    if (leaf.power <= 0.0f) { return 1.0f / leaf.n_lights; }
+    return leafLightPower(leaf, k) / leaf.power;
+  }
+
+  // probability of selecting first child, -1 if both children have no
+  // importance
+  float firstChildProb(const glm::vec3& p, int first, int second) const
+  {
+    const float first_importance = importance(p, m_nodes[first]);
+    const float second_importance = importance(p, m_nodes[second]);
+    const float sum = first_importance + second_importance;
+    if (sum <= 0.0f) { return -1.0f; }
+    return first_importance / sum;
+  }
+
+  // estimate contribution of node to shading point p
+  float importance(const glm::vec3& p, const BVHNode& node) const
+  {
+    const glm::vec3 center = node.bbox.center();
+    const float radius =
+        0.5f * glm::length(node.bbox.bounds[1] - node.bbox.bounds[0]);
+
+    const glm::vec3 d = p - center;
+    const float dist2 = glm::dot(d, d);
+
+    // p is inside of bounding sphere, any direction is possible
+    if (dist2 <= radius * radius) { return node.power / (radius * radius); }
+
+    // angle between cone axis and direction to p
+    const float dist = glm::sqrt(dist2);
+    const float cos_theta = glm::abs(glm::dot(node.cone.axis, d / dist));
+    const float theta = glm::acos(glm::min(cos_theta, 1.0f));
+
+    // angle subtended by bounding sphere
+    const float theta_u = glm::asin(radius / dist);
+
+    // minimum angle between emitting direction and direction to p
+    const float theta_min =
+        glm::max(theta - node.cone.theta - theta_u, 0.0f);
+    if (theta_min >= 0.5f * M_PIf) { return 0.0f; }
+
+    return node.power * glm::cos(theta_min) / dist2;
+  }
+};
\ No newline at end of file
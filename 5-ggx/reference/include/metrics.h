@@ -0,0 +1,426 @@
+#pragma once
+#include <cmath>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+// error metrics of rendered image against reference
+// images are linear RGB, and each metric is computed as per pixel error map
+// in parallel over rows, whose mean is error of whole image
+
+// epsilon of relative error, which avoids division by 0 in dark pixels
+constexpr float REL_MSE_EPSILON = 1e-2f;
+
+// per pixel squared error averaged over channels
+// relative: divide squared error by squared reference + epsilon
+inline std::vector<float> squared_error_map(const float* image,
+                                            const float* reference, int width,
+                                            int height, bool relative)
+{
+  std::vector<float> map(width * height);
+#pragma omp parallel for
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      const int idx = i + width * j;
+      float sum = 0.0f;
+      for (int c = 0; c < 3; ++c) {
+        const float x = image[3 * idx + c];
+        const float r = reference[3 * idx + c];
+        const float d = x - r;
+        sum += relative ? d * d / (r * r + REL_MSE_EPSILON) : d * d;
+      }
+      map[idx] = sum / 3.0f;
+    }
+  }
+  return map;
+}
+
+// mean of error map, which is accumulated in double
+inline double mean_error(const std::vector<float>& map)
+{
+  double sum = 0.0;
+  const int n = map.size();
+#pragma omp parallel for reduction(+ : sum)
+  for (int idx = 0; idx < n; ++idx) { sum += map[idx]; }
+  return n > 0 ? sum / n : 0.0;
+}
+
+// mean squared error
+inline double mse(const float* image, const float* reference, int width,
+                  int height)
+{
+  return mean_error(
+      squared_error_map(image, reference, width, height, false));
+}
+
+// relative mean squared error
+inline double rel_mse(const float* image, const float* reference, int width,
+                      int height)
+{
+  return mean_error(squared_error_map(image, reference, width, height, true));
+}
+
+// mean of error map in each tile of tile_size x tile_size
+// return: tile errors in row major order of tiles
+inline std::vector<float> tile_errors(const std::vector<float>& map,
+                                      int width, int height, int tile_size)
+{
+  const int n_tiles_x = (width + tile_size - 1) / tile_size;
+  const int n_tiles_y = (height + tile_size - 1) / tile_size;
+  std::vector<float> errors(n_tiles_x * n_tiles_y);
+#pragma omp parallel for
+  for (int ty = 0; ty < n_tiles_y; ++ty) {
+    for (int tx = 0; tx < n_tiles_x; ++tx) {
+      const int x0 = tx * tile_size;
+      const int y0 = ty * tile_size;
+      const int x1 = glm::min(x0 + tile_size, width);
+      const int y1 = glm::min(y0 + tile_size, height);
+      double sum = 0.0;
+      for (int j = y0; j < y1; ++j) {
+        for (int i = x0; i < x1; ++i) { sum += map[i + width * j]; }
+      }
+      errors[tx + n_tiles_x * ty] = sum / ((x1 - x0) * (y1 - y0));
+    }
+  }
+  return errors;
+}
+
+// color of heatmap for t in [0, 1], which is piecewise linear fit of magma
+// colormap in sRGB
+inline glm::vec3 heatmap_color(float t)
+{
+  constexpr int N_STOPS = 5;
+  const glm::vec3 stops[N_STOPS] = {
+      glm::vec3(0.001f, 0.000f, 0.014f), glm::vec3(0.316f, 0.072f, 0.485f),
+      glm::vec3(0.716f, 0.215f, 0.475f), glm::vec3(0.987f, 0.535f, 0.382f),
+      glm::vec3(0.987f, 0.991f, 0.750f)};
+  const float x = glm::clamp(t, 0.0f, 1.0f) * (N_STOPS - 1);
+  const int k = glm::min(static_cast<int>(x), N_STOPS - 2);
+  return stops[k] + (x - k) * (stops[k + 1] - stops[k]);
+}
+
+// make 8 bit sRGB heatmap of tile errors with same size as image
+// each pixel is colored by error of its tile divided by max_error
+inline std::vector<unsigned char> make_tile_heatmap(
+    const std::vector<float>& errors, int width, int height, int tile_size,
+    float max_error)
+{
+  const int n_tiles_x = (width + tile_size - 1) / tile_size;
+  std::vector<unsigned char> heatmap(3 * width * height);
+#pragma omp parallel for
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      const float error = errors[i / tile_size + n_tiles_x * (j / tile_size)];
+      const glm::vec3 color =
+          heatmap_color(max_error > 0.0f ? error / max_error : 0.0f);
+      for (int c = 0; c < 3; ++c) {
+        heatmap[3 * (i + width * j) + c] =
+            static_cast<unsigned char>(255.0f * color[c] + 0.5f);
+      }
+    }
+  }
+  return heatmap;
+}
+
+// perceptual error in the manner of FLIP
+// Andersson, P., Nilsson, J., Akenine-Möller, T., Oskarsson, M., Åström, K.,
+// & Fairchild, M. D. (2020). FLIP: A Difference Evaluator for Alternating
+// Images.
+// color difference of images filtered by contrast sensitivity functions is
+// combined with difference of edges and points. error is in [0, 1] for each
+// pixel. images must be display sRGB in [0, 1], so that HDR renders are
+// post processed first. CSF filters are approximated by sums of gaussians,
+// and all filters are separable.
+class FlipMetric
+{
+ public:
+  // ppd: pixels per degree of visual angle, default is 4K monitor of 0.7m
+  // width seen from 0.7m, same as FLIP
+  FlipMetric(float ppd = 67.0f) : m_ppd(ppd) {}
+
+  // per pixel error between image and reference
+  std::vector<float> computeMap(const float* image, const float* reference,
+                                int width, int height) const
+  {
+    const int n = width * height;
+
+    // YCxCz planes, and achromatic plane for features
+    std::vector<float> image_ycxcz[3], reference_ycxcz[3];
+    toYCxCz(image, n, image_ycxcz);
+    toYCxCz(reference, n, reference_ycxcz);
+    std::vector<float> image_y = achromatic(image_ycxcz[0]);
+    std::vector<float> reference_y = achromatic(reference_ycxcz[0]);
+
+    // spatial filter with CSFs
+    for (int c = 0; c < 3; ++c) {
+      filterCSF(image_ycxcz[c], width, height, c);
+      filterCSF(reference_ycxcz[c], width, height, c);
+    }
+
+    // feature magnitudes
+    std::vector<float> image_edges, image_points;
+    std::vector<float> reference_edges, reference_points;
+    detectFeatures(image_y, width, height, image_edges, image_points);
+    detectFeatures(reference_y, width, height, reference_edges,
+                   reference_points);
+
+    // normalization of color difference by difference of green and blue
+    const float c_max = glm::pow(
+        hyab(huntLab(glm::vec3(0, 1, 0)), huntLab(glm::vec3(0, 0, 1))), QC);
+
+    std::vector<float> map(n);
+#pragma omp parallel for
+    for (int idx = 0; idx < n; ++idx) {
+      const glm::vec3 lab1 = huntLab(fromYCxCz(image_ycxcz, idx));
+      const glm::vec3 lab2 = huntLab(fromYCxCz(reference_ycxcz, idx));
+
+      // compress large differences
+      const float color = glm::pow(hyab(lab1, lab2), QC);
+      const float color_error =
+          color < PC * c_max
+              ? PT / (PC * c_max) * color
+              : PT + (color - PC * c_max) / (c_max - PC * c_max) * (1 - PT);
+
+      const float feature =
+          glm::max(glm::abs(image_edges[idx] - reference_edges[idx]),
+                   glm::abs(image_points[idx] - reference_points[idx]));
+      const float feature_error = glm::pow(feature / std::sqrt(2.0f), QF);
+
+      map[idx] = glm::pow(glm::min(color_error, 1.0f), 1.0f - feature_error);
+    }
+    return map;
+  }
+
+ private:
+  // exponent of color difference
+  static constexpr float QC = 0.7f;
+  // exponent of feature difference
+  static constexpr float QF = 0.5f;
+  // fraction of color differences which maps to PT
+  static constexpr float PC = 0.4f;
+  // error of color difference PC * c_max
+  static constexpr float PT = 0.95f;
+  // width of features in degrees
+  static constexpr float FEATURE_WIDTH = 0.082f;
+
+  float m_ppd;  // pixels per degree
+
+  // white point D65
+  static glm::vec3 whitePoint()
+  {
+    return glm::vec3(0.950428f, 1.0f, 1.088900f);
+  }
+
+  static glm::vec3 linearToXYZ(const glm::vec3& rgb)
+  {
+    return glm::vec3(
+        0.4124564f * rgb.x + 0.3575761f * rgb.y + 0.1804375f * rgb.z,
+        0.2126729f * rgb.x + 0.7151522f * rgb.y + 0.0721750f * rgb.z,
+        0.0193339f * rgb.x + 0.1191920f * rgb.y + 0.9503041f * rgb.z);
+  }
+
+  static glm::vec3 xyzToLinear(const glm::vec3& xyz)
+  {
+    return glm::vec3(
+        3.2404542f * xyz.x - 1.5371385f * xyz.y - 0.4985314f * xyz.z,
+        -0.9692660f * xyz.x + 1.8760108f * xyz.y + 0.0415560f * xyz.z,
+        0.0556434f * xyz.x - 0.2040259f * xyz.y + 1.0572252f * xyz.z);
+  }
+
+  static float srgbToLinear(float v)
+  {
+    return v <= 0.04045f ? v / 12.92f
+                         : glm::pow((v + 0.055f) / 1.055f, 2.4f);
+  }
+
+  // sRGB image into planes of opponent color space YCxCz
+  static void toYCxCz(const float* image, int n, std::vector<float>* planes)
+  {
+    for (int c = 0; c < 3; ++c) { planes[c].resize(n); }
+    const glm::vec3 white = whitePoint();
+#pragma omp parallel for
+    for (int idx = 0; idx < n; ++idx) {
+      const glm::vec3 rgb(srgbToLinear(image[3 * idx + 0]),
+                          srgbToLinear(image[3 * idx + 1]),
+                          srgbToLinear(image[3 * idx + 2]));
+      const glm::vec3 xyz = linearToXYZ(rgb) / white;
+      planes[0][idx] = 116.0f * xyz.y - 16.0f;
+      planes[1][idx] = 500.0f * (xyz.x - xyz.y);
+      planes[2][idx] = 200.0f * (xyz.y - xyz.z);
+    }
+  }
+
+  // linear RGB of pixel idx of YCxCz planes, clamped to [0, 1]
+  static glm::vec3 fromYCxCz(const std::vector<float>* planes, int idx)
+  {
+    const float y = (planes[0][idx] + 16.0f) / 116.0f;
+    const glm::vec3 xyz = glm::vec3(planes[1][idx] / 500.0f + y, y,
+                                    y - planes[2][idx] / 200.0f) *
+                          whitePoint();
+    return glm::clamp(xyzToLinear(xyz), 0.0f, 1.0f);
+  }
+
+  // normalized luminance in [0, 1] of Y plane
+  static std::vector<float> achromatic(const std::vector<float>& plane)
+  {
+    const int n = plane.size();
+    std::vector<float> y(n);
+#pragma omp parallel for
+    for (int idx = 0; idx < n; ++idx) {
+      y[idx] = (plane[idx] + 16.0f) / 116.0f;
+    }
+    return y;
+  }
+
+  // L*a*b* of linear RGB whose a*, b* are scaled by L* to model Hunt effect
+  static glm::vec3 huntLab(const glm::vec3& rgb)
+  {
+    const glm::vec3 xyz = linearToXYZ(rgb) / whitePoint();
+    const auto f = [](float t) {
+      constexpr float DELTA = 6.0f / 29.0f;
+      return t > DELTA * DELTA * DELTA ? std::cbrt(t)
+                                       : t / (3.0f * DELTA * DELTA) +
+                                             4.0f / 29.0f;
+    };
+    const float l = 116.0f * f(xyz.y) - 16.0f;
+    const float a = 500.0f * (f(xyz.x) - f(xyz.y));
+    const float b = 200.0f * (f(xyz.y) - f(xyz.z));
+    return glm::vec3(l, 0.01f * l * a, 0.01f * l * b);
+  }
+
+  // HyAB distance, which is city block in L* and euclidean in a*b*
+  static float hyab(const glm::vec3& lab1, const glm::vec3& lab2)
+  {
+    const glm::vec3 d = lab1 - lab2;
+    return glm::abs(d.x) + std::sqrt(d.y * d.y + d.z * d.z);
+  }
+
+  // convolve plane with separable kernel of radius (kernel.size() - 1) / 2
+  // in x and y, edges are clamped
+  static std::vector<float> convolve(const std::vector<float>& plane,
+                                     int width, int height,
+                                     const std::vector<float>& kernel_x,
+                                     const std::vector<float>& kernel_y)
+  {
+    const int radius = (kernel_x.size() - 1) / 2;
+    std::vector<float> tmp(plane.size()), out(plane.size());
+#pragma omp parallel for
+    for (int j = 0; j < height; ++j) {
+      for (int i = 0; i < width; ++i) {
+        float sum = 0.0f;
+        for (int k = -radius; k <= radius; ++k) {
+          const int x = glm::clamp(i + k, 0, width - 1);
+          sum += kernel_x[k + radius] * plane[x + width * j];
+        }
+        tmp[i + width * j] = sum;
+      }
+    }
+#pragma omp parallel for
+    for (int j = 0; j < height; ++j) {
+      for (int i = 0; i < width; ++i) {
+        float sum = 0.0f;
+        for (int k = -radius; k <= radius; ++k) {
+          const int y = glm::clamp(j + k, 0, height - 1);
+          sum += kernel_y[k + radius] * tmp[i + width * y];
+        }
+        out[i + width * j] = sum;
+      }
+    }
+    return out;
+  }
+
+  // filter channel c of YCxCz with CSF, which is sum of two gaussians
+  // a * sqrt(pi / b) * exp(-pi^2 x^2 / b) of x in degrees
+  void filterCSF(std::vector<float>& plane, int width, int height,
+                 int c) const
+  {
+    // parameters (a1, b1, a2, b2) of Y, Cx and Cz
+    constexpr float CSF[3][4] = {{1.0f, 0.0047f, 0.0f, 1e-5f},
+                                 {1.0f, 0.0053f, 0.0f, 1e-5f},
+                                 {34.1f, 0.04f, 13.5f, 0.025f}};
+
+    // radius of widest gaussian of all channels
+    const float sigma_max = std::sqrt(0.04f / (2.0f * M_PIf * M_PIf));
+    const int radius = std::ceil(3.0f * sigma_max * m_ppd);
+
+    // 1D gaussians, and weight of each in normalized 2D kernel
+    std::vector<float> gaussians[2];
+    float weights[2];
+    float weight_sum = 0.0f;
+    for (int g = 0; g < 2; ++g) {
+      const float a = CSF[c][2 * g];
+      const float b = CSF[c][2 * g + 1];
+      gaussians[g].resize(2 * radius + 1);
+      float sum = 0.0f;
+      for (int k = -radius; k <= radius; ++k) {
+        const float x = k / m_ppd;
+        gaussians[g][k + radius] = std::exp(-M_PIf * M_PIf * x * x / b);
+        sum += gaussians[g][k + radius];
+      }
+      for (float& v : gaussians[g]) { v /= sum; }
+      weights[g] = a * M_PIf / b * sum * sum;
+      weight_sum += weights[g];
+    }
+
+    std::vector<float> filtered(plane.size(), 0.0f);
+    for (int g = 0; g < 2; ++g) {
+      if (weights[g] == 0.0f) { continue; }
+      const std::vector<float> blurred =
+          convolve(plane, width, height, gaussians[g], gaussians[g]);
+      const float w = weights[g] / weight_sum;
+      const int n = plane.size();
+#pragma omp parallel for
+      for (int idx = 0; idx < n; ++idx) {
+        filtered[idx] += w * blurred[idx];
+      }
+    }
+    plane.swap(filtered);
+  }
+
+  // magnitudes of edges and points of achromatic plane, which are filtered
+  // by first and second derivatives of gaussian
+  void detectFeatures(const std::vector<float>& y, int width, int height,
+                      std::vector<float>& edges,
+                      std::vector<float>& points) const
+  {
+    const float sigma = 0.5f * FEATURE_WIDTH * m_ppd;
+    const int radius = std::ceil(3.0f * sigma);
+
+    // gaussian, and its derivatives whose positive and negative weights are
+    // normalized to sum to 1 and -1
+    std::vector<float> g(2 * radius + 1), dg(2 * radius + 1),
+        ddg(2 * radius + 1);
+    float sum = 0.0f;
+    for (int k = -radius; k <= radius; ++k) {
+      g[k + radius] = std::exp(-k * k / (2.0f * sigma * sigma));
+      sum += g[k + radius];
+    }
+    for (int k = 0; k <= 2 * radius; ++k) {
+      g[k] /= sum;
+      const float x = k - radius;
+      dg[k] = -x * g[k];
+      ddg[k] = (x * x / (sigma * sigma) - 1.0f) * g[k];
+    }
+    const auto normalize = [](std::vector<float>& kernel) {
+      float positive = 0.0f, negative = 0.0f;
+      for (const float v : kernel) { (v > 0.0f ? positive : negative) += v; }
+      for (float& v : kernel) { v /= v > 0.0f ? positive : -negative; }
+    };
+    normalize(dg);
+    normalize(ddg);
+
+    const std::vector<float> edge_x = convolve(y, width, height, dg, g);
+    const std::vector<float> edge_y = convolve(y, width, height, g, dg);
+    const std::vector<float> point_x = convolve(y, width, height, ddg, g);
+    const std::vector<float> point_y = convolve(y, width, height, g, ddg);
+
+    const int n = width * height;
+    edges.resize(n);
+    points.resize(n);
+#pragma omp parallel for
+    for (int idx = 0; idx < n; ++idx) {
+      edges[idx] = std::hypot(edge_x[idx], edge_y[idx]);
+      points[idx] = std::hypot(point_x[idx], point_y[idx]);
+    }
+  }
+};
\ No newline at end of file
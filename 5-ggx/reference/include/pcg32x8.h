@@ -0,0 +1,222 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "sampler.h"
+
+// 8 interleaved PCG32 streams
+// lane i produces the same sequence as scalar pcg32_random_r initialized by
+// pcg32_srandom_r(initstate, 8 * initseq + i)
+struct alignas(64) pcg32x8_random_t {
+  uint64_t state[8];
+  uint64_t inc[8];
+};
+
+// initialize 8 streams
+// initstate: initial state
+// initseq: id of 8 streams
+inline void pcg32x8_srandom_r(pcg32x8_random_t* rng, uint64_t initstate,
+                              uint64_t initseq)
+{
+  for (int i = 0; i < 8; ++i) {
+    pcg32_random_t lane;
+    pcg32_srandom_r(&lane, initstate, 8 * initseq + i);
+    rng->state[i] = lane.state;
+    rng->inc[i] = lane.inc;
+  }
+}
+
+// generate 8 random numbers without SIMD
+inline void pcg32x8_random_scalar_r(pcg32x8_random_t* rng, uint32_t out[8])
+{
+  for (int i = 0; i < 8; ++i) {
+    pcg32_random_t lane = {rng->state[i], rng->inc[i]};
+    out[i] = pcg32_random_r(&lane);
+    rng->state[i] = lane.state;
+  }
+}
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__) && defined(__AVX512VL__)
+
+// 8 64bit values held in one register(AVX-512)
+typedef __m512i pcg32x8_simd_t;
+
+inline pcg32x8_simd_t pcg32x8_load_simd(const uint64_t* p)
+{
+  return _mm512_load_si512(p);
+}
+
+inline void pcg32x8_store_simd(uint64_t* p, const pcg32x8_simd_t& v)
+{
+  _mm512_store_si512(p, v);
+}
+
+// return mult * state + inc
+inline pcg32x8_simd_t pcg32x8_lcg_simd(const pcg32x8_simd_t& state,
+                                       const pcg32x8_simd_t& mult,
+                                       const pcg32x8_simd_t& inc)
+{
+  return _mm512_add_epi64(_mm512_mullo_epi64(state, mult), inc);
+}
+
+// output function (XSH RR) of 8 states
+inline __m256i pcg32x8_output_simd(const pcg32x8_simd_t& oldstate)
+{
+  const __m512i xorshifted = _mm512_srli_epi64(
+      _mm512_xor_si512(_mm512_srli_epi64(oldstate, 18), oldstate), 27);
+  const __m512i rot = _mm512_srli_epi64(oldstate, 59);
+  return _mm256_rorv_epi32(_mm512_cvtepi64_epi32(xorshifted),
+                           _mm512_cvtepi64_epi32(rot));
+}
+
+#define PCG32X8_SIMD "AVX-512"
+
+#elif defined(__AVX2__)
+
+// 8 64bit values held in two registers(AVX2)
+struct pcg32x8_simd_t {
+  __m256i lo;  // lane 0-3
+  __m256i hi;  // lane 4-7
+};
+
+inline pcg32x8_simd_t pcg32x8_load_simd(const uint64_t* p)
+{
+  const __m256i* v = reinterpret_cast<const __m256i*>(p);
+  return {_mm256_load_si256(v), _mm256_load_si256(v + 1)};
+}
+
+inline void pcg32x8_store_simd(uint64_t* p, const pcg32x8_simd_t& v)
+{
+  __m256i* ret = reinterpret_cast<__m256i*>(p);
+  _mm256_store_si256(ret, v.lo);
+  _mm256_store_si256(ret + 1, v.hi);
+}
+
+// 64bit multiplication(lower 64bit)
+inline __m256i pcg32x4_mullo_avx2(__m256i a, __m256i b)
+{
+  const __m256i a_hi = _mm256_srli_epi64(a, 32);
+  const __m256i b_hi = _mm256_srli_epi64(b, 32);
+  const __m256i lo = _mm256_mul_epu32(a, b);
+  const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(a_hi, b),
+                                         _mm256_mul_epu32(a, b_hi));
+  return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+// return mult * state + inc
+inline pcg32x8_simd_t pcg32x8_lcg_simd(const pcg32x8_simd_t& state,
+                                       const pcg32x8_simd_t& mult,
+                                       const pcg32x8_simd_t& inc)
+{
+  return {
+      _mm256_add_epi64(pcg32x4_mullo_avx2(state.lo, mult.lo), inc.lo),
+      _mm256_add_epi64(pcg32x4_mullo_avx2(state.hi, mult.hi), inc.hi)};
+}
+
+// output function (XSH RR) of 4 states
+// results are stored in lower 32bit of each 64bit lane
+inline __m256i pcg32x4_output_avx2(__m256i oldstate)
+{
+  const __m256i xorshifted = _mm256_srli_epi64(
+      _mm256_xor_si256(_mm256_srli_epi64(oldstate, 18), oldstate), 27);
+  const __m256i rot = _mm256_srli_epi64(oldstate, 59);
+  const __m256i rot_inv =
+      _mm256_and_si256(_mm256_sub_epi32(_mm256_setzero_si256(), rot),
+                       _mm256_set1_epi32(31));
+  return _mm256_or_si256(_mm256_srlv_epi32(xorshifted, rot),
+                         _mm256_sllv_epi32(xorshifted, rot_inv));
+}
+
+// output function (XSH RR) of 8 states
+inline __m256i pcg32x8_output_simd(const pcg32x8_simd_t& oldstate)
+{
+  const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  const __m256i lo =
+      _mm256_permutevar8x32_epi32(pcg32x4_output_avx2(oldstate.lo), even);
+  const __m256i hi =
+      _mm256_permutevar8x32_epi32(pcg32x4_output_avx2(oldstate.hi), even);
+  return _mm256_permute2x128_si256(lo, hi, 0x20);
+}
+
+#define PCG32X8_SIMD "AVX2"
+
+#endif
+
+// generate 8 random numbers
+inline void pcg32x8_random_r(pcg32x8_random_t* rng, uint32_t out[8])
+{
+#ifdef PCG32X8_SIMD
+  alignas(64) uint64_t mult[8];
+  for (int i = 0; i < 8; ++i) { mult[i] = 6364136223846793005ULL; }
+
+  const pcg32x8_simd_t state = pcg32x8_load_simd(rng->state);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                      pcg32x8_output_simd(state));
+  pcg32x8_store_simd(rng->state,
+                     pcg32x8_lcg_simd(state, pcg32x8_load_simd(mult),
+                                      pcg32x8_load_simd(rng->inc)));
+#else
+  pcg32x8_random_scalar_r(rng, out);
+#endif
+}
+
+// fill array with uniform floats in [0, 1)
+// out[8 * k + i] comes from lane i, and the remaining numbers of the last
+// batch are discarded when n is not multiple of 8
+inline void pcg32x8_fill_uniform(pcg32x8_random_t* rng, float* out, size_t n)
+{
+  size_t idx = 0;
+#ifdef PCG32X8_SIMD
+  // LCG is latency bound by multiplication, so compute 4 states ahead from
+  // same state at once. k steps ahead is mult_k * state + inc_k, where
+  // mult_k = mult^k, inc_k = inc * (mult^(k-1) + ... + 1)
+  constexpr int n_steps = 4;
+  alignas(64) uint64_t mult_k[n_steps][8];
+  alignas(64) uint64_t inc_k[n_steps][8];
+  for (int i = 0; i < 8; ++i) {
+    uint64_t m = 1u;
+    uint64_t c = 0u;
+    for (int k = 0; k < n_steps; ++k) {
+      m *= 6364136223846793005ULL;
+      c = c * 6364136223846793005ULL + rng->inc[i];
+      mult_k[k][i] = m;
+      inc_k[k][i] = c;
+    }
+  }
+  pcg32x8_simd_t mult[n_steps], inc[n_steps];
+  for (int k = 0; k < n_steps; ++k) {
+    mult[k] = pcg32x8_load_simd(mult_k[k]);
+    inc[k] = pcg32x8_load_simd(inc_k[k]);
+  }
+
+  // keep states in register during the loop
+  pcg32x8_simd_t state = pcg32x8_load_simd(rng->state);
+  const __m256 scale = _mm256_set1_ps(1.0f / (1u << 24));
+  for (; idx + 8 * n_steps <= n; idx += 8 * n_steps) {
+    pcg32x8_simd_t states[n_steps + 1];
+    states[0] = state;
+    for (int k = 0; k < n_steps; ++k) {
+      states[k + 1] = pcg32x8_lcg_simd(state, mult[k], inc[k]);
+    }
+    for (int k = 0; k < n_steps; ++k) {
+      const __m256i x = _mm256_srli_epi32(pcg32x8_output_simd(states[k]), 8);
+      _mm256_storeu_ps(out + idx + 8 * k,
+                       _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+    }
+    state = states[n_steps];
+  }
+  pcg32x8_store_simd(rng->state, state);
+#endif
+
+  uint32_t x[8];
+  for (; idx < n; idx += 8) {
+    pcg32x8_random_scalar_r(rng, x);
+    for (size_t i = 0; i < 8 && idx + i < n; ++i) {
+      out[idx + i] = (x[i] >> 8) * (1.0f / (1u << 24));
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,171 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+// tone mapping operator
+enum class Tonemapper {
+  NONE,      // clamp to [0, 1]
+  REINHARD,  // x / (1 + x)
+  ACES,      // Narkowicz's fit of ACES filmic curve
+  AGX,       // AgX with polynomial fit of its sigmoid
+};
+
+// parse name of tonemapper(none, reinhard, aces, agx)
+inline Tonemapper parse_tonemapper(const std::string& name)
+{
+  if (name == "none") { return Tonemapper::NONE; }
+  if (name == "reinhard") { return Tonemapper::REINHARD; }
+  if (name == "aces") { return Tonemapper::ACES; }
+  if (name == "agx") { return Tonemapper::AGX; }
+  throw std::runtime_error("unknown tonemapper " + name);
+}
+
+// post processing of linear radiance into display sRGB
+// exposure -> tone mapping -> sRGB encode
+// rows are processed in parallel, and inner loop is instantiated for each
+// tonemapper without branches so that it can be vectorized. sRGB encode uses
+// lookup table with linear interpolation instead of pow.
+class PostProcess
+{
+ public:
+  // exposure: exposure compensation in EV
+  PostProcess(float exposure = 0.0f, Tonemapper tonemapper = Tonemapper::NONE)
+      : m_scale(glm::exp2(exposure)), m_tonemapper(tonemapper)
+  {
+  }
+
+  // process image in place, result is sRGB in [0, 1]
+  void apply(float* image, int width, int height) const
+  {
+    dispatch(image, width, height,
+             [&](int idx, float v) { image[idx] = v; });
+  }
+
+  // process image into 8 bit sRGB, image is read only once
+  void apply(const float* image, int width, int height,
+             unsigned char* output) const
+  {
+    dispatch(image, width, height, [&](int idx, float v) {
+      output[idx] = static_cast<unsigned char>(255.0f * v);
+    });
+  }
+
+ private:
+  // number of intervals of sRGB encode table
+  static constexpr int SRGB_TABLE_SIZE = 4096;
+
+  float m_scale;            // exposure scale
+  Tonemapper m_tonemapper;  // tone mapping operator
+
+  // sRGB encode of [0, 1], table has one extra entry for interpolation
+  static const std::vector<float>& srgbTable()
+  {
+    static const std::vector<float> table = []() {
+      std::vector<float> t(SRGB_TABLE_SIZE + 1);
+      for (int k = 0; k <= SRGB_TABLE_SIZE; ++k) {
+        const double x = static_cast<double>(k) / SRGB_TABLE_SIZE;
+        t[k] = x < 0.0031308 ? 12.92 * x
+                             : 1.055 * glm::pow(x, 1.0 / 2.4) - 0.055;
+      }
+      return t;
+    }();
+    return table;
+  }
+
+  // sRGB encode of linear value, which is clamped to [0, 1](NaN to 0)
+  static float srgbEncode(const float* table, float v)
+  {
+    const float x = (v > 0.0f ? glm::min(v, 1.0f) : 0.0f) * SRGB_TABLE_SIZE;
+    const int k = glm::min(static_cast<int>(x), SRGB_TABLE_SIZE - 1);
+    const float t = x - k;
+    return table[k] + t * (table[k + 1] - table[k]);
+  }
+
+  // polynomial fit of AgX sigmoid
+  static float agxContrast(float x)
+  {
+    const float x2 = x * x;
+    const float x4 = x2 * x2;
+    return 15.5f * x4 * x2 - 40.14f * x4 * x + 31.96f * x4 -
+           6.868f * x2 * x + 0.4298f * x2 + 0.1191f * x - 0.00232f;
+  }
+
+  // tone map radiance into linear display value
+  template <Tonemapper T>
+  static glm::vec3 tonemap(const glm::vec3& c)
+  {
+    glm::vec3 ret;
+    if constexpr (T == Tonemapper::NONE) {
+      ret = c;
+    } else if constexpr (T == Tonemapper::REINHARD) {
+      ret = c / (1.0f + c);
+    } else if constexpr (T == Tonemapper::ACES) {
+      ret = (c * (2.51f * c + 0.03f)) / (c * (2.43f * c + 0.59f) + 0.14f);
+    } else {
+      // inset, then log2 encode into [MIN_EV, MAX_EV] and apply sigmoid
+      constexpr float MIN_EV = -12.47393f;
+      constexpr float MAX_EV = 4.026069f;
+      const glm::vec3 inset(
+          0.842479f * c.x + 0.0784336f * c.y + 0.0792237f * c.z,
+          0.0423282f * c.x + 0.878469f * c.y + 0.0791661f * c.z,
+          0.0423757f * c.x + 0.0784336f * c.y + 0.879143f * c.z);
+      glm::vec3 v;
+      for (int k = 0; k < 3; ++k) {
+        const float ev = glm::clamp(glm::log2(glm::max(inset[k], 1e-10f)),
+                                    MIN_EV, MAX_EV);
+        v[k] = agxContrast((ev - MIN_EV) / (MAX_EV - MIN_EV));
+      }
+      // outset, and decode display gamma 2.2 into linear
+      const glm::vec3 outset(
+          1.19688f * v.x - 0.0980209f * v.y - 0.0990297f * v.z,
+          -0.0528969f * v.x + 1.15190f * v.y - 0.0989612f * v.z,
+          -0.0529716f * v.x - 0.0980435f * v.y + 1.15107f * v.z);
+      for (int k = 0; k < 3; ++k) {
+        ret[k] = glm::pow(glm::max(outset[k], 0.0f), 2.2f);
+      }
+    }
+    return ret;
+  }
+
+  // process all pixels and pass sRGB value of each channel to store
+  template <Tonemapper T, typename F>
+  void process(const float* image, int width, int height, F store) const
+  {
+    const float* table = srgbTable().data();
+#pragma omp parallel for
+    for (int j = 0; j < height; ++j) {
+#pragma omp simd
+      for (int i = 0; i < width; ++i) {
+        const int idx = 3 * i + 3 * width * j;
+        const glm::vec3 c = tonemap<T>(
+            m_scale * glm::vec3(image[idx], image[idx + 1], image[idx + 2]));
+        store(idx, srgbEncode(table, c.x));
+        store(idx + 1, srgbEncode(table, c.y));
+        store(idx + 2, srgbEncode(table, c.z));
+      }
+    }
+  }
+
+  template <typename F>
+  void dispatch(const float* image, int width, int height, F store) const
+  {
+    switch (m_tonemapper) {
+      case Tonemapper::NONE:
+        process<Tonemapper::NONE>(image, width, height, store);
+        break;
+      case Tonemapper::REINHARD:
+        process<Tonemapper::REINHARD>(image, width, height, store);
+        break;
+      case Tonemapper::ACES:
+        process<Tonemapper::ACES>(image, width, height, store);
+        break;
+      case Tonemapper::AGX:
+        process<Tonemapper::AGX>(image, width, height, store);
+        break;
+    }
+  }
+};
\ No newline at end of file
@@ -0,0 +1,314 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "camera.h"
+#include "checkpoint.h"
+#include "core.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "io.h"
+#include "sampler.h"
+#include "sky.h"
+#include "spdlog/spdlog.h"
+#include "tile.h"
+
+// progressive rendering
+// image is rendered in passes of samples_per_pass samples per pixel, and
+// rendering stops at the end of the pass which reaches max_samples, the time
+// budget or the target error. since it only stops between passes, the result
+// of n passes is the same regardless of machine speed.
+// error is estimated from two half buffers which accumulate even and odd
+// passes, as the worst relative difference among image blocks. half buffers
+// are summed in double across passes, and rounded to float only at resolve.
+// render state can be saved to checkpoint file between passes. if the file
+// exists when render starts, rendering resumes from it and gives the same
+// result as uninterrupted run. the file is removed when render finishes.
+class ProgressiveRendering
+{
+ public:
+  // time_budget: time limit in seconds, 0 means no limit
+  // target_error: stop when estimated error is below this, 0 means no limit
+  ProgressiveRendering(uint32_t samples_per_pass, uint32_t max_samples,
+                       float time_budget = 0.0f, float target_error = 0.0f)
+      : m_samples_per_pass(samples_per_pass),
+        m_max_samples(max_samples),
+        m_time_budget(time_budget),
+        m_target_error(target_error)
+  {
+  }
+
+  // write intermediate image every interval seconds
+  void setIntermediateOutput(const std::string& filename, float interval)
+  {
+    m_output_filename = filename;
+    m_output_interval = interval;
+  }
+
+  // write checkpoint every interval seconds, and resume from it if exists
+  // settings_hash: hash of render settings not known by this class(scene,
+  // integrator, sampler type, max depth...), see settings_hash()
+  void setCheckpoint(const std::string& filename, float interval,
+                     uint64_t settings_hash)
+  {
+    m_checkpoint_filename = filename;
+    m_checkpoint_interval = interval;
+    m_settings_hash = settings_hash;
+  }
+
+  // render image and set mean radiance of each pixel to image
+  template <typename SamplerT>
+  void render(const Camera& camera, const Integrator& integrator,
+              const Intersector& intersector, const Sky& sky,
+              const SamplerT& sampler, TileScheduler& scheduler, Image& image)
+  {
+    const int width = image.getWidth();
+    const int height = image.getHeight();
+
+    // sum of radiance(RGB) of even and odd passes
+    std::vector<double> half_buffers[2] = {
+        std::vector<double>(3 * width * height, 0.0),
+        std::vector<double>(3 * width * height, 0.0)};
+    uint32_t n_half_samples[2] = {0, 0};
+
+    std::vector<SamplerT> samplers(scheduler.getNumThreads(), sampler);
+
+    uint32_t first_pass = 0;
+    float elapsed_offset = 0.0f;
+    m_n_samples = 0;
+    if (!m_checkpoint_filename.empty()) {
+      loadCheckpoint(sampler, width, height, half_buffers, n_half_samples,
+                     first_pass, elapsed_offset);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    float last_output = elapsed_offset;
+    float last_checkpoint = elapsed_offset;
+    for (uint32_t pass = first_pass; m_n_samples < m_max_samples; ++pass) {
+      const uint32_t sample_start = m_n_samples;
+      const uint32_t sample_end =
+          glm::min(m_n_samples + m_samples_per_pass, m_max_samples);
+
+      std::vector<double>& half_buffer = half_buffers[pass % 2];
+      scheduler.render(half_buffer, [&](const Tile& tile, int thread_id,
+                                        TileAccumulator& accumulation) {
+        SamplerT& sampler = samplers[thread_id];
+        for (int j = tile.y0; j < tile.y1; ++j) {
+          for (int i = tile.x0; i < tile.x1; ++i) {
+            render_pixel(i, j, sample_start, sample_end, width, height,
+                         camera, integrator, intersector, sky, sampler,
+                         accumulation);
+          }
+        }
+      });
+      n_half_samples[pass % 2] += sample_end - sample_start;
+      m_n_samples = sample_end;
+
+      const float elapsed = elapsed_offset +
+                            std::chrono::duration<float>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+
+      // error estimate needs both half buffers
+      m_error = -1.0f;
+      if (n_half_samples[1] > 0) {
+        m_error = estimateError(half_buffers, n_half_samples, width, height);
+      }
+      spdlog::info("[ProgressiveRendering] pass {}: {} spp, error {:.4f}, {:.2f}s",
+                   pass, m_n_samples, m_error, elapsed);
+
+      // write intermediate image
+      if (!m_output_filename.empty() &&
+          elapsed - last_output >= m_output_interval) {
+        Image intermediate(width, height);
+        resolve(half_buffers, intermediate);
+        write_png(m_output_filename, width, height,
+                  intermediate.getConstPtr(), PostProcess());
+        last_output = elapsed;
+      }
+
+      // write checkpoint
+      if (!m_checkpoint_filename.empty() &&
+          elapsed - last_checkpoint >= m_checkpoint_interval) {
+        saveCheckpoint(sampler, width, height, half_buffers, n_half_samples,
+                       pass + 1, elapsed);
+        last_checkpoint = elapsed;
+      }
+
+      if (m_time_budget > 0.0f && elapsed >= m_time_budget) {
+        spdlog::info("[ProgressiveRendering] time budget is used up");
+        break;
+      }
+      if (m_target_error > 0.0f && m_error >= 0.0f &&
+          m_error < m_target_error) {
+        spdlog::info("[ProgressiveRendering] converged");
+        break;
+      }
+    }
+
+    resolve(half_buffers, image);
+    scheduler.logStatistics();
+
+    // render is finished, so checkpoint is no longer needed
+    if (!m_checkpoint_filename.empty()) {
+      remove_checkpoint(m_checkpoint_filename);
+    }
+  }
+
+  // number of samples per pixel taken by last render
+  uint32_t getNumSamples() const { return m_n_samples; }
+
+  // estimated error at the end of last render, -1 if not available
+  float getError() const { return m_error; }
+
+ private:
+  // added to denominator of relative error to suppress dark pixels
+  static constexpr float ERROR_EPS = 1e-2f;
+  // width and height of block used in error estimation
+  static constexpr int ERROR_BLOCK_SIZE = 16;
+
+  uint32_t m_samples_per_pass;  // number of samples per pixel in one pass
+  uint32_t m_max_samples;       // maximum number of samples per pixel
+  float m_time_budget;          // time limit in seconds
+  float m_target_error;         // target of estimated error
+
+  std::string m_output_filename;  // filename of intermediate image
+  float m_output_interval = 0.0f;  // interval of intermediate output
+
+  std::string m_checkpoint_filename;  // filename of checkpoint
+  float m_checkpoint_interval = 0.0f;  // interval of checkpoint
+  uint64_t m_settings_hash = 0;        // hash of render settings
+
+  uint32_t m_n_samples = 0;  // number of samples taken
+  float m_error = -1.0f;     // estimated error
+
+  // restore render state from checkpoint file if it exists
+  // checkpoint of different render settings, image size, sampler seed or
+  // samples per pass is ignored, since resuming from it can't reproduce
+  // uninterrupted run. unreadable checkpoint, such as one of older version,
+  // is ignored too, and it is overwritten by next save
+  void loadCheckpoint(const Sampler& sampler, int width, int height,
+                      std::vector<double> half_buffers[2],
+                      uint32_t n_half_samples[2], uint32_t& n_passes,
+                      float& elapsed)
+  {
+    Checkpoint checkpoint;
+    try {
+      if (!read_checkpoint(m_checkpoint_filename, checkpoint)) { return; }
+    } catch (const std::exception& e) {
+      spdlog::warn("[ProgressiveRendering] {}, start from scratch", e.what());
+      return;
+    }
+
+    if (checkpoint.settings_hash != m_settings_hash ||
+        checkpoint.width != width || checkpoint.height != height ||
+        checkpoint.sampler_seed != sampler.getSeed() ||
+        checkpoint.samples_per_pass != m_samples_per_pass) {
+      spdlog::warn("[ProgressiveRendering] checkpoint {} doesn't match, "
+                   "start from scratch",
+                   m_checkpoint_filename);
+      return;
+    }
+
+    for (int k = 0; k < 2; ++k) {
+      half_buffers[k] = checkpoint.half_buffers[k];
+      n_half_samples[k] = checkpoint.n_half_samples[k];
+    }
+    n_passes = checkpoint.n_passes;
+    elapsed = checkpoint.elapsed;
+    m_n_samples = n_half_samples[0] + n_half_samples[1];
+
+    spdlog::info("[ProgressiveRendering] resume from pass {}: {} spp",
+                 n_passes, m_n_samples);
+  }
+
+  // save render state after n_passes passes to checkpoint file
+  void saveCheckpoint(const Sampler& sampler, int width, int height,
+                      const std::vector<double> half_buffers[2],
+                      const uint32_t n_half_samples[2], uint32_t n_passes,
+                      float elapsed) const
+  {
+    Checkpoint checkpoint;
+    checkpoint.settings_hash = m_settings_hash;
+    checkpoint.width = width;
+    checkpoint.height = height;
+    checkpoint.sampler_seed = sampler.getSeed();
+    checkpoint.samples_per_pass = m_samples_per_pass;
+    checkpoint.n_passes = n_passes;
+    checkpoint.elapsed = elapsed;
+    for (int k = 0; k < 2; ++k) {
+      checkpoint.half_buffers[k] = half_buffers[k];
+      checkpoint.n_half_samples[k] = n_half_samples[k];
+    }
+    // every pixel has same number of samples in progressive rendering
+    checkpoint.sample_counts.assign(width * height, m_n_samples);
+
+    try {
+      write_checkpoint(m_checkpoint_filename, checkpoint);
+    } catch (const std::exception& e) {
+      // failure of checkpoint shouldn't stop rendering
+      spdlog::error("[ProgressiveRendering] {}", e.what());
+    }
+  }
+
+  // set mean of two half buffers to image, rounded to float
+  void resolve(const std::vector<double> half_buffers[2], Image& image) const
+  {
+    const int width = image.getWidth();
+    for (int j = 0; j < image.getHeight(); ++j) {
+      for (int i = 0; i < width; ++i) {
+        const int idx = 3 * (i + width * j);
+        const glm::dvec3 sum(
+            half_buffers[0][idx + 0] + half_buffers[1][idx + 0],
+            half_buffers[0][idx + 1] + half_buffers[1][idx + 1],
+            half_buffers[0][idx + 2] + half_buffers[1][idx + 2]);
+        image.setPixel(i, j,
+                       glm::vec3(sum / static_cast<double>(m_n_samples)));
+      }
+    }
+  }
+
+  // luminance of pixel of half buffer
+  static double pixelLuminance(const std::vector<double>& half_buffer,
+                               int i, int j, int width)
+  {
+    const int idx = 3 * (i + width * j);
+    return 0.2126 * half_buffer[idx + 0] + 0.7152 * half_buffer[idx + 1] +
+           0.0722 * half_buffer[idx + 2];
+  }
+
+  // relative difference between two half buffers
+  // it is averaged in each block, and the worst block is returned, so that
+  // converged background doesn't hide noise of small objects
+  float estimateError(const std::vector<double> half_buffers[2],
+                      const uint32_t n_half_samples[2], int width,
+                      int height) const
+  {
+    float max_error = 0.0f;
+    for (int by = 0; by < height; by += ERROR_BLOCK_SIZE) {
+      for (int bx = 0; bx < width; bx += ERROR_BLOCK_SIZE) {
+        const int x_end = glm::min(bx + ERROR_BLOCK_SIZE, width);
+        const int y_end = glm::min(by + ERROR_BLOCK_SIZE, height);
+
+        double sum = 0.0;
+        for (int j = by; j < y_end; ++j) {
+          for (int i = bx; i < x_end; ++i) {
+            const double a = pixelLuminance(half_buffers[0], i, j, width) /
+                             n_half_samples[0];
+            const double b = pixelLuminance(half_buffers[1], i, j, width) /
+                             n_half_samples[1];
+            sum += glm::abs(a - b) / (ERROR_EPS + a + b);
+          }
+        }
+        const float error = sum / ((x_end - bx) * (y_end - by));
+        max_error = glm::max(max_error, error);
+      }
+    }
+    return max_error;
+  }
+};
\ No newline at end of file
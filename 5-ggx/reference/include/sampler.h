@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <iterator>
+#include <vector>
 
 #include "core.h"
 #include "glm/glm.hpp"
@@ -24,10 +25,68 @@ inline uint32_t pcg32_random_r(pcg32_random_t* rng)
   return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
 }
 
+// PCG32 initialization with given initial state and stream id
+// initstate: initial state
+// initseq: stream id(different streams never overlap)
+inline void pcg32_srandom_r(pcg32_random_t* rng, uint64_t initstate,
+                            uint64_t initseq)
+{
+  rng->state = 0U;
+  rng->inc = (initseq << 1u) | 1u;
+  pcg32_random_r(rng);
+  rng->state += initstate;
+  pcg32_random_r(rng);
+}
+
+// advance PCG32 state by delta steps in O(log(delta))
+// Brown, F. B. (1994). Random number generation with arbitrary strides.
+inline void pcg32_advance_r(pcg32_random_t* rng, uint64_t delta)
+{
+  uint64_t cur_mult = 6364136223846793005ULL;
+  uint64_t cur_plus = rng->inc | 1;
+  uint64_t acc_mult = 1u;
+  uint64_t acc_plus = 0u;
+  while (delta > 0) {
+    if (delta & 1) {
+      acc_mult *= cur_mult;
+      acc_plus = acc_plus * cur_mult + cur_plus;
+    }
+    cur_plus = (cur_mult + 1) * cur_plus;
+    cur_mult *= cur_mult;
+    delta /= 2;
+  }
+  rng->state = acc_mult * rng->state + acc_plus;
+}
+
 class Sampler
 {
  public:
-  Sampler(uint64_t seed)
+  Sampler(uint64_t seed) : m_seed(seed) {}
+
+  // start sample sequence of given pixel and sample index
+  // sequence depends only on (seed, pixel_index, sample_index), so the result
+  // is the same regardless of thread count or schedule
+  virtual void startPixelSample(uint32_t pixel_index,
+                                uint32_t sample_index) = 0;
+
+  // generate 1d float sample
+  virtual float next_1d() = 0;
+
+  // generate 2d float sample
+  virtual glm::vec2 next_2d() = 0;
+
+  // seed of sample sequence
+  uint64_t getSeed() const { return m_seed; }
+
+ protected:
+  uint64_t m_seed;  // seed of sample sequence
+};
+
+// PCG32 white noise sampler
+class RandomSampler : public Sampler
+{
+ public:
+  RandomSampler(uint64_t seed) : Sampler(seed)
   {
     state.state = seed;
     state.inc = 0xdeadbeef;
@@ -36,16 +95,143 @@ class Sampler
     for (int i = 0; i < 10; ++i) { next_1d(); }
   }
 
-  // generate 1d float sample
-  float next_1d() { return pcg32_random_r(&state) * (1.0f / (1ULL << 32)); }
+  // each pixel uses its own PCG stream, and each sample skips 2^16 numbers
+  void startPixelSample(uint32_t pixel_index, uint32_t sample_index) override
+  {
+    pcg32_srandom_r(&state, m_seed, pixel_index);
+    pcg32_advance_r(&state, static_cast<uint64_t>(sample_index) << 16);
+  }
 
-  // generate 2d float sample
-  glm::vec2 next_2d() { return glm::vec2(next_1d(), next_1d()); }
+  float next_1d() override
+  {
+    return pcg32_random_r(&state) * (1.0f / (1ULL << 32));
+  }
+
+  glm::vec2 next_2d() override
+  {
+    const float x = next_1d();
+    const float y = next_1d();
+    return glm::vec2(x, y);
+  }
 
  private:
   pcg32_random_t state;
 };
 
+// reverse bits of 32bit integer
+inline uint32_t reverse_bits(uint32_t x)
+{
+  x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+  x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+  x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+  x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+  return (x >> 16) | (x << 16);
+}
+
+// 32bit integer hash
+// https://nullprogram.com/blog/2018/07/31/
+inline uint32_t hash_u32(uint32_t x)
+{
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+// combine seed with value
+inline uint32_t hash_combine(uint32_t seed, uint32_t v)
+{
+  return seed ^ (hash_u32(v) + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+// first two dimensions of sobol sequence
+// dimension 0 is van der Corput sequence, dimension 1 is generated by
+// pascal matrix
+inline uint32_t sobol_2d(uint32_t index, int dim)
+{
+  if (dim == 0) { return reverse_bits(index); }
+
+  uint32_t ret = 0;
+  uint32_t v = 1u << 31;
+  for (; index != 0; index >>= 1) {
+    if (index & 1) { ret ^= v; }
+    v ^= v >> 1;
+  }
+  return ret;
+}
+
+// Owen scrambling with hash function
+// Burley, B. (2020). Practical hash-based Owen scrambling. JCGT, 9(4).
+inline uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed)
+{
+  x = reverse_bits(x);
+
+  // Laine-Karras permutation
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+
+  return reverse_bits(x);
+}
+
+// Owen-scrambled sobol sampler
+// each next_1d/next_2d call consumes one dimension, which is padded from the
+// first two dimensions of sobol sequence with its own scrambling seed
+class SobolSampler : public Sampler
+{
+ public:
+  SobolSampler(uint64_t seed) : Sampler(seed) {}
+
+  void startPixelSample(uint32_t pixel_index, uint32_t sample_index) override
+  {
+    m_pixel_seed = hash_combine(hash_u32(m_seed), pixel_index);
+    m_sample_index = sample_index;
+    m_dimension = 0;
+  }
+
+  float next_1d() override
+  {
+    const uint32_t seed = nextDimensionSeed();
+    return sample(shuffledIndex(seed), 0, seed);
+  }
+
+  glm::vec2 next_2d() override
+  {
+    const uint32_t seed = nextDimensionSeed();
+    const uint32_t index = shuffledIndex(seed);
+    return glm::vec2(sample(index, 0, seed), sample(index, 1, seed));
+  }
+
+ private:
+  uint32_t m_pixel_seed = 0;    // seed of current pixel
+  uint32_t m_sample_index = 0;  // current sample index
+  uint32_t m_dimension = 0;     // current dimension
+
+  uint32_t nextDimensionSeed()
+  {
+    return hash_combine(m_pixel_seed, m_dimension++);
+  }
+
+  // shuffle sample order, so each dimension is paired randomly
+  uint32_t shuffledIndex(uint32_t seed) const
+  {
+    return nested_uniform_scramble(m_sample_index, hash_combine(seed, 0));
+  }
+
+  // return scrambled sobol sample of given dimension(0 or 1)
+  static float sample(uint32_t index, int dim, uint32_t seed)
+  {
+    const uint32_t x = nested_uniform_scramble(sobol_2d(index, dim),
+                                               hash_combine(seed, dim + 1));
+    // use upper 24 bits, so the result is in [0, 1)
+    return (x >> 8) * (1.0f / (1u << 24));
+  }
+};
+
 // uniform disk sampling
 inline glm::vec2 sample_uniform_disk(const glm::vec2& u)
 {
@@ -62,6 +248,14 @@ inline glm::vec3 sample_hemisphere(const glm::vec2& u)
   return spherical_to_cartesian(phi, theta);
 }
 
+// uniform sphere sampling
+inline glm::vec3 sample_uniform_sphere(const glm::vec2& u)
+{
+  const float theta = glm::acos(glm::clamp(1.0f - 2.0f * u[0], -1.0f, 1.0f));
+  const float phi = 2.0f * M_PIf * u[1];
+  return spherical_to_cartesian(phi, theta);
+}
+
 // cosine weighted hemisphere sampling
 inline glm::vec3 sample_cosine_weighted_hemisphere(const glm::vec2& u)
 {
@@ -91,11 +285,19 @@ class DiscreteDistribution1D
 
   int sample(float u, float& pmf) const
   {
-    const int idx = binary_search(m_cdf.data(), m_cdf.size(), u);
+    // clamp index, since u can exceed the last cdf value by rounding error
+    const int idx = glm::min(binary_search(m_cdf.data(), m_cdf.size(), u),
+                             static_cast<int>(m_cdf.size()) - 2);
     pmf = m_cdf[idx + 1] - m_cdf[idx];
     return idx;
   }
 
+  // probability of sampling idx
+  float pmf(int idx) const { return m_cdf[idx + 1] - m_cdf[idx]; }
+
+  // probability of sampling index smaller than idx
+  float cdf(int idx) const { return m_cdf[idx]; }
+
  private:
   static int binary_search(const float* values, int size, float value)
   {
@@ -116,4 +318,39 @@ class DiscreteDistribution1D
   }
 
   std::vector<float> m_cdf;
+};
+
+// discrete distribution with fixed number of entries
+// cdf is stored inline, so it can be constructed without heap allocation
+template <int N>
+class FixedDiscreteDistribution1D
+{
+ public:
+  FixedDiscreteDistribution1D() {}
+  FixedDiscreteDistribution1D(const float* values)
+  {
+    float sum = 0.0f;
+    for (int i = 0; i < N; ++i) { sum += values[i]; }
+
+    // compute cdf
+    m_cdf[0] = 0.0f;
+    for (int i = 1; i < N + 1; ++i) {
+      m_cdf[i] = m_cdf[i - 1] + values[i - 1] / sum;
+    }
+  }
+
+  int sample(float u, float& pmf) const
+  {
+    // linear search is enough for small N
+    int idx = 0;
+    while (idx < N - 1 && u >= m_cdf[idx + 1]) { idx++; }
+    pmf = m_cdf[idx + 1] - m_cdf[idx];
+    return idx;
+  }
+
+  // probability of sampling idx
+  float pmf(int idx) const { return m_cdf[idx + 1] - m_cdf[idx]; }
+
+ private:
+  float m_cdf[N + 1];
 };
\ No newline at end of file
@@ -0,0 +1,241 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "io.h"
+#include "postprocess.h"
+
+// output of image which receives rows from top to bottom in bands, and
+// appends them to file as soon as they arrive, so that whole image doesn't
+// have to be kept in memory
+class ScanlineWriter
+{
+ public:
+  ScanlineWriter(const std::string& filename, int width, int height)
+      : m_filename(filename), m_width(width), m_height(height)
+  {
+    m_file.open(filename, std::ios::binary);
+    if (!m_file.is_open()) {
+      throw std::runtime_error("failed to open " + filename);
+    }
+  }
+
+  virtual ~ScanlineWriter() = default;
+
+  // get number of rows written so far
+  int getNumRows() const { return m_n_rows; }
+
+  // write next n_rows rows
+  // rows: image data of rows(linear RGB)
+  void writeRows(const float* rows, int n_rows)
+  {
+    if (m_n_rows + n_rows > m_height) {
+      throw std::runtime_error("too many rows for " + m_filename);
+    }
+    write(rows, n_rows);
+    m_n_rows += n_rows;
+    check();
+  }
+
+  // finish file after all rows are written
+  void close()
+  {
+    if (m_n_rows != m_height) {
+      throw std::runtime_error("missing rows of " + m_filename);
+    }
+    finish();
+    check();
+    m_file.close();
+  }
+
+ protected:
+  std::string m_filename;  // output filename
+  int m_width;             // width of image
+  int m_height;            // height of image
+  int m_n_rows = 0;        // number of rows written
+  std::ofstream m_file;    // output file
+
+  // write rows [m_n_rows, m_n_rows + n_rows)
+  virtual void write(const float* rows, int n_rows) = 0;
+
+  // write end of file
+  virtual void finish() {}
+
+  void writeBytes(const void* data, size_t size)
+  {
+    m_file.write(reinterpret_cast<const char*>(data), size);
+  }
+
+  void check() const
+  {
+    if (!m_file) { throw std::runtime_error("failed to write " + m_filename); }
+  }
+};
+
+// binary ppm(P6) writer of post processed 8 bit sRGB
+class PpmScanlineWriter : public ScanlineWriter
+{
+ public:
+  PpmScanlineWriter(const std::string& filename, int width, int height,
+                    const PostProcess& post_process)
+      : ScanlineWriter(filename, width, height), m_post_process(post_process)
+  {
+    m_file << "P6\n" << width << " " << height << "\n255\n";
+    check();
+  }
+
+ private:
+  PostProcess m_post_process;         // exposure and tone mapping
+  std::vector<unsigned char> m_data;  // converted rows
+
+  void write(const float* rows, int n_rows) override
+  {
+    m_data.resize(3 * m_width * n_rows);
+    m_post_process.apply(rows, m_width, n_rows, m_data.data());
+    writeBytes(m_data.data(), m_data.size());
+  }
+};
+
+// png writer of post processed 8 bit sRGB
+// each band is filtered and deflated in parallel into IDAT chunks, and last
+// row is kept to filter first row of next band
+class PngScanlineWriter : public ScanlineWriter
+{
+ public:
+  // compression_level: 0(store) to 9(best)
+  PngScanlineWriter(const std::string& filename, int width, int height,
+                    const PostProcess& post_process, int compression_level = 6)
+      : ScanlineWriter(filename, width, height),
+        m_post_process(post_process),
+        m_compression_level(compression_level)
+  {
+    const std::vector<unsigned char> header = make_png_header(width, height);
+    writeBytes(header.data(), header.size());
+    check();
+  }
+
+ private:
+  PostProcess m_post_process;             // exposure and tone mapping
+  int m_compression_level;                // compression level
+  uint32_t m_adler = 1;                   // adler-32 of filtered rows
+  std::vector<unsigned char> m_data;      // converted rows
+  std::vector<unsigned char> m_last_row;  // last row of previous band
+
+  void write(const float* rows, int n_rows) override
+  {
+    const size_t row_size = 3 * static_cast<size_t>(m_width);
+    m_data.resize(row_size * n_rows);
+    m_post_process.apply(rows, m_width, n_rows, m_data.data());
+
+    const std::vector<std::vector<unsigned char>> chunks =
+        make_png_idat_chunks(m_data.data(),
+                             m_n_rows > 0 ? m_last_row.data() : nullptr,
+                             m_width, n_rows, m_compression_level, false,
+                             m_adler);
+    for (const auto& chunk : chunks) { writeBytes(chunk.data(), chunk.size()); }
+
+    m_last_row.assign(m_data.end() - row_size, m_data.end());
+  }
+
+  void finish() override
+  {
+    const std::vector<unsigned char> trailer = make_png_trailer(m_adler, true);
+    writeBytes(trailer.data(), trailer.size());
+    const std::vector<unsigned char> end = make_png_chunk("IEND", {});
+    writeBytes(end.data(), end.size());
+  }
+};
+
+// scanline exr writer of linear radiance
+// offset table is written with zeros first, and filled when file is closed.
+// rows which don't fill a chunk are kept until next band.
+class ExrScanlineWriter : public ScanlineWriter
+{
+ public:
+  ExrScanlineWriter(const std::string& filename, int width, int height,
+                    ExrCompression compression = ExrCompression::ZIP)
+      : ScanlineWriter(filename, width, height),
+        m_compression(compression),
+        m_lines_per_chunk(exr_lines_per_chunk(compression))
+  {
+    const std::string header = make_exr_header(width, height, compression);
+    writeBytes(header.data(), header.size());
+
+    const int n_chunks = (height + m_lines_per_chunk - 1) / m_lines_per_chunk;
+    m_offsets.resize(n_chunks, 0);
+    m_offset_table_position = m_file.tellp();
+    writeBytes(m_offsets.data(), m_offsets.size() * sizeof(uint64_t));
+    check();
+  }
+
+ private:
+  ExrCompression m_compression;            // compression of chunks
+  int m_lines_per_chunk;                   // number of scanlines in one chunk
+  std::vector<uint64_t> m_offsets;         // offset of each chunk in file
+  std::streampos m_offset_table_position;  // position of offset table
+  std::vector<float> m_pending;            // rows which don't fill a chunk
+
+  void write(const float* rows, int n_rows) override
+  {
+    const size_t row_size = 3 * static_cast<size_t>(m_width);
+    m_pending.insert(m_pending.end(), rows, rows + row_size * n_rows);
+
+    // first row of pending rows, and number of rows which form chunks
+    const int y_start = m_n_rows - (m_pending.size() / row_size - n_rows);
+    const int y_end = m_n_rows + n_rows;
+    int n_chunk_rows = (y_end - y_start) / m_lines_per_chunk *
+                       m_lines_per_chunk;
+    // last chunk of image can be short
+    if (y_end == m_height) { n_chunk_rows = y_end - y_start; }
+
+    const int n_chunks =
+        (n_chunk_rows + m_lines_per_chunk - 1) / m_lines_per_chunk;
+    std::vector<std::vector<unsigned char>> chunks(n_chunks);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < n_chunks; ++c) {
+      const int y0 = y_start + c * m_lines_per_chunk;
+      const int y1 = glm::min(y0 + m_lines_per_chunk, y_start + n_chunk_rows);
+      chunks[c] = make_exr_chunk(m_width, y0, y1,
+                                 &m_pending[row_size * (y0 - y_start)],
+                                 m_compression);
+    }
+
+    for (int c = 0; c < n_chunks; ++c) {
+      m_offsets[y_start / m_lines_per_chunk + c] = m_file.tellp();
+      writeBytes(chunks[c].data(), chunks[c].size());
+    }
+
+    m_pending.erase(m_pending.begin(),
+                    m_pending.begin() + row_size * n_chunk_rows);
+  }
+
+  void finish() override
+  {
+    m_file.seekp(m_offset_table_position);
+    writeBytes(m_offsets.data(), m_offsets.size() * sizeof(uint64_t));
+  }
+};
+
+// make scanline writer of format chosen by extension(.exr, .ppm or .png)
+// post_process is applied to ppm and png, exr keeps linear radiance
+inline std::unique_ptr<ScanlineWriter> make_scanline_writer(
+    const std::string& filename, int width, int height,
+    const PostProcess& post_process = PostProcess())
+{
+  const std::string extension = std::filesystem::path(filename).extension();
+  if (extension == ".exr") {
+    return std::make_unique<ExrScanlineWriter>(filename, width, height);
+  } else if (extension == ".ppm") {
+    return std::make_unique<PpmScanlineWriter>(filename, width, height,
+                                               post_process);
+  } else if (extension == ".png") {
+    return std::make_unique<PngScanlineWriter>(filename, width, height,
+                                               post_process);
+  }
+  throw std::runtime_error("unsupported format " + filename);
+}
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "glm/glm.hpp"
+#include "light.h"
 #include "primitive.h"
 #include "shape.h"
 #include "spdlog/spdlog.h"
@@ -61,7 +62,8 @@ struct Scene {
 
     // load materials
     for (const auto& m : materials) {
-      const Material material = loadMaterial(m, filepath.parent_path());
+      Material material = loadMaterial(m, filepath.parent_path());
+      material.id = m_materials.size();
       m_materials.push_back(material);
     }
 
@@ -148,9 +150,20 @@ struct Scene {
       m_primitives.emplace_back(&m_triangles[f], &m_materials[material_id]);
     }
 
+    // load area lights
+    m_lights.clear();
+    for (uint32_t f = 0; f < m_triangles.size(); ++f) {
+      const Primitive& primitive = m_primitives[f];
+      if (primitive.has_emission()) {
+        m_lights.emplace_back(primitive.shape,
+                              primitive.material->emission_color);
+      }
+    }
+
     spdlog::info("[Scene] number of primitives: {}", m_primitives.size());
     spdlog::info("[Scene] number of materials: {}", m_materials.size());
     spdlog::info("[Scene] number of textures: {}", m_textures.size());
+    spdlog::info("[Scene] number of lights: {}", m_lights.size());
   }
 
   // convert tinyobj::material_t to Material
@@ -189,6 +202,8 @@ struct Scene {
       mat.emission_color_tex = &m_textures[texture_id];
     }
 
+    mat.precompute();
+
     return mat;
   }
 
@@ -210,4 +225,7 @@ struct Scene {
 
   // array of primitives
   std::vector<Primitive> m_primitives;
+
+  // array of area lights(emissive triangles)
+  std::vector<AreaLight> m_lights;
 };
\ No newline at end of file
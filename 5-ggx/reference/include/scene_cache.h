@@ -0,0 +1,138 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "intersector.h"
+#include "scene.h"
+#include "sky.h"
+#include "spdlog/spdlog.h"
+
+// scene with built bvh
+struct CachedScene {
+  std::unique_ptr<Scene> scene;
+  std::unique_ptr<BVHOptimized> intersector;
+};
+
+// material libraries referenced by mtllib of obj, which are searched in the
+// directory of obj like tinyobjloader
+inline std::vector<std::filesystem::path> obj_material_libraries(
+    const std::filesystem::path& filepath)
+{
+  std::vector<std::filesystem::path> libraries;
+  std::ifstream file(filepath);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream ss(line);
+    std::string command, name;
+    if (!(ss >> command) || command != "mtllib") { continue; }
+    while (ss >> name) { libraries.push_back(filepath.parent_path() / name); }
+  }
+  return libraries;
+}
+
+// cache of scenes and skies shared between render jobs
+// entries are keyed by filepath, and reloaded when modification time of any
+// file loaded for the entry(obj, mtl and textures of scene) changes.
+// returned shared_ptr keeps entry alive even if it is reloaded while a job is
+// using it.
+class SceneCache
+{
+ public:
+  SceneCache() {}
+
+  // get scene loaded from obj and its bvh
+  std::shared_ptr<const CachedScene> getScene(
+      const std::filesystem::path& filepath)
+  {
+    return get<CachedScene>(m_scenes, filepath, [&](Files& files) {
+      // mtime is taken before loading, so that modification during loading
+      // causes reload next time
+      addFile(files, filepath);
+      for (const auto& library : obj_material_libraries(filepath)) {
+        addFile(files, library);
+      }
+
+      auto cached = std::make_shared<CachedScene>();
+      cached->scene = std::make_unique<Scene>();
+      cached->scene->loadObj(filepath);
+      cached->intersector = std::make_unique<BVHOptimized>(
+          cached->scene->m_primitives.data(),
+          cached->scene->m_primitives.size());
+      cached->intersector->buildBVH();
+
+      for (const auto& texture : cached->scene->m_unique_textures) {
+        addFile(files, texture.first);
+      }
+      return cached;
+    });
+  }
+
+  // get image based lighting loaded from hdr
+  std::shared_ptr<const IBL> getSky(const std::filesystem::path& filepath)
+  {
+    return get<IBL>(m_skies, filepath, [&](Files& files) {
+      addFile(files, filepath);
+      return std::make_shared<IBL>(filepath);
+    });
+  }
+
+ private:
+  // files loaded for entry and their modification times
+  using Files = std::vector<
+      std::pair<std::filesystem::path, std::filesystem::file_time_type>>;
+
+  template <typename T>
+  struct Entry {
+    Files files;
+    std::shared_ptr<const T> value;
+  };
+
+  std::mutex m_mutex;
+  std::map<std::string, Entry<CachedScene>> m_scenes;
+  std::map<std::string, Entry<IBL>> m_skies;
+
+  static void addFile(Files& files, const std::filesystem::path& filepath)
+  {
+    files.emplace_back(filepath, std::filesystem::last_write_time(filepath));
+  }
+
+  // true if any file is modified or removed since it was loaded
+  static bool isModified(const Files& files)
+  {
+    for (const auto& file : files) {
+      std::error_code error;
+      const auto mtime = std::filesystem::last_write_time(file.first, error);
+      if (error || mtime != file.second) { return true; }
+    }
+    return false;
+  }
+
+  // return cached value, or load it if not cached or modified
+  // load: returns value and adds files it depends on
+  template <typename T, typename F>
+  std::shared_ptr<const T> get(std::map<std::string, Entry<T>>& entries,
+                               const std::filesystem::path& filepath, F load)
+  {
+    const std::string key = std::filesystem::absolute(filepath).string();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = entries.find(key);
+    if (it != entries.end() && !isModified(it->second.files)) {
+      spdlog::info("[SceneCache] hit {}", key);
+      return it->second.value;
+    }
+
+    spdlog::info("[SceneCache] load {}", key);
+    Entry<T> entry;
+    entry.value = load(entry.files);
+    entries[key] = entry;
+    return entry.value;
+  }
+};
\ No newline at end of file
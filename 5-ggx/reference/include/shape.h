@@ -16,6 +16,27 @@ class Shape
 
   // get bounding box
   virtual AABB getBounds() const = 0;
+
+  // get surface area
+  virtual float area() const = 0;
+
+  // sample point on surface uniformly
+  // u: [0, 1] x [0, 1] random number
+  // normal: surface normal at sampled point
+  // pdf: pdf value(area measure)
+  // return: sampled position
+  virtual glm::vec3 samplePoint(const glm::vec2& u, glm::vec3& normal,
+                                float& pdf) const = 0;
+
+  // get geometric normal at position on surface
+  // this is the normal used by samplePoint, unlike interpolated normal of
+  // intersection
+  virtual glm::vec3 geometricNormal(const glm::vec3& position) const = 0;
+
+  // get bounding cone of surface normals
+  // axis: axis of cone
+  // theta: half angle of cone
+  virtual void getNormalBounds(glm::vec3& axis, float& theta) const = 0;
 };
 
 class Sphere : public Shape
@@ -56,6 +77,30 @@ class Sphere : public Shape
     return AABB(m_center - r, m_center + r);
   }
 
+  float area() const override { return 4.0f * M_PIf * m_radius * m_radius; }
+
+  glm::vec3 samplePoint(const glm::vec2& u, glm::vec3& normal,
+                        float& pdf) const override
+  {
+    const float theta = glm::acos(glm::clamp(1.0f - 2.0f * u[0], -1.0f, 1.0f));
+    const float phi = 2.0f * M_PIf * u[1];
+    normal = spherical_to_cartesian(phi, theta);
+    pdf = 1.0f / area();
+    return m_center + m_radius * normal;
+  }
+
+  glm::vec3 geometricNormal(const glm::vec3& position) const override
+  {
+    return glm::normalize(position - m_center);
+  }
+
+  void getNormalBounds(glm::vec3& axis, float& theta) const override
+  {
+    // normals cover whole sphere
+    axis = glm::vec3(0, 1, 0);
+    theta = M_PIf;
+  }
+
  private:
   glm::vec3 m_center;  // center of sphere
   float m_radius;      // radius of sphere
@@ -118,6 +163,36 @@ class Triangle : public Shape
     return AABB(pmin - AABB_EPS, pmax + AABB_EPS);
   }
 
+  float area() const override
+  {
+    return 0.5f * glm::length(glm::cross(m_v1 - m_v0, m_v2 - m_v0));
+  }
+
+  glm::vec3 samplePoint(const glm::vec2& u, glm::vec3& normal,
+                        float& pdf) const override
+  {
+    // uniform sampling of barycentric coordinate
+    const float su0 = glm::sqrt(u[0]);
+    const float b0 = 1.0f - su0;
+    const float b1 = u[1] * su0;
+
+    // use geometric normal
+    normal = glm::normalize(glm::cross(m_v1 - m_v0, m_v2 - m_v0));
+    pdf = 1.0f / area();
+    return b0 * m_v0 + b1 * m_v1 + (1.0f - b0 - b1) * m_v2;
+  }
+
+  glm::vec3 geometricNormal(const glm::vec3& position) const override
+  {
+    return glm::normalize(glm::cross(m_v1 - m_v0, m_v2 - m_v0));
+  }
+
+  void getNormalBounds(glm::vec3& axis, float& theta) const override
+  {
+    axis = glm::normalize(glm::cross(m_v1 - m_v0, m_v2 - m_v0));
+    theta = 0.0f;
+  }
+
  private:
   // vertex positions
   glm::vec3 m_v0;
@@ -1,9 +1,12 @@
 #pragma once
 #include <cmath>
+#include <algorithm>
 #include <filesystem>
+#include <vector>
 
 #include "core.h"
 #include "glm/glm.hpp"
+#include "sampler.h"
 #include "texture.h"
 
 class Sky
@@ -11,6 +14,15 @@ class Sky
  public:
   // evaluate incoming radiance
   virtual glm::vec3 evaluate(const Ray& ray) const = 0;
+
+  // sample direction toward sky
+  // u: [0, 1] x [0, 1] random number
+  // pdf: pdf value(solid angle measure)
+  // return: sampled direction in world space
+  virtual glm::vec3 sampleDirection(const glm::vec2& u, float& pdf) const = 0;
+
+  // evaluate pdf of sampling direction(solid angle measure)
+  virtual float pdf(const glm::vec3& direction) const = 0;
 };
 
 // uniform color sky
@@ -21,6 +33,17 @@ class UniformSky : public Sky
 
   glm::vec3 evaluate(const Ray& ray) const override { return m_albedo; }
 
+  glm::vec3 sampleDirection(const glm::vec2& u, float& pdf) const override
+  {
+    pdf = 1.0f / (4.0f * M_PIf);
+    return sample_uniform_sphere(u);
+  }
+
+  float pdf(const glm::vec3& direction) const override
+  {
+    return 1.0f / (4.0f * M_PIf);
+  }
+
  private:
   glm::vec3 m_albedo;  // sky color
 };
@@ -29,7 +52,10 @@ class UniformSky : public Sky
 class IBL : public Sky
 {
  public:
-  IBL(const std::filesystem::path& filepath) : m_texture{filepath} {}
+  IBL(const std::filesystem::path& filepath) : m_texture{filepath}
+  {
+    buildDistribution();
+  }
 
   glm::vec3 evaluate(const Ray& ray) const override
   {
@@ -41,6 +67,97 @@ class IBL : public Sky
     return m_texture.fetch(texcoord);
   }
 
+  glm::vec3 sampleDirection(const glm::vec2& u, float& pdf) const override
+  {
+    // sample row, then column in the row
+    float row_pmf, column_pmf;
+    const int j = m_row_distribution.sample(u.y, row_pmf);
+    const int i = m_column_distributions[j].sample(u.x, column_pmf);
+
+    // reuse u to sample uniformly inside of the texel
+    const float su = column_pmf > 0.0f
+                         ? (u.x - m_column_distributions[j].cdf(i)) / column_pmf
+                         : 0.5f;
+    const float sv =
+        row_pmf > 0.0f ? (u.y - m_row_distribution.cdf(j)) / row_pmf : 0.5f;
+    const glm::vec2 texcoord((i + glm::clamp(su, 0.0f, 1.0f)) / m_n_columns,
+                             (j + glm::clamp(sv, 0.0f, 1.0f)) / m_n_rows);
+
+    const float phi = 2.0f * M_PIf * texcoord.x;
+    const float theta = M_PIf * (1.0f - texcoord.y);
+    pdf = texelPdf(row_pmf * column_pmf, theta);
+    return spherical_to_cartesian(phi, theta);
+  }
+
+  float pdf(const glm::vec3& direction) const override
+  {
+    float phi, theta;
+    cartesian_to_spherical(direction, phi, theta);
+
+    const int i = glm::min(
+        static_cast<int>(phi / (2.0f * M_PIf) * m_n_columns), m_n_columns - 1);
+    const int j =
+        glm::min(static_cast<int>((1.0f - theta / M_PIf) * m_n_rows),
+                 m_n_rows - 1);
+    return texelPdf(
+        m_row_distribution.pmf(j) * m_column_distributions[j].pmf(i), theta);
+  }
+
  private:
   Texture m_texture;  // ibl texture
+
+  // texture fetch maps [0, 1] to [0, size - 1] with truncation, so the
+  // distribution has (size - 1) texels in each direction
+  int m_n_columns;  // number of texels in phi direction
+  int m_n_rows;     // number of texels in theta direction
+
+  DiscreteDistribution1D m_row_distribution;  // marginal distribution of rows
+  std::vector<DiscreteDistribution1D>
+      m_column_distributions;  // conditional distribution of each row
+
+  // build piecewise constant distribution proportional to luminance
+  void buildDistribution()
+  {
+    m_n_columns = glm::max(m_texture.getWidth() - 1, 1);
+    m_n_rows = glm::max(m_texture.getHeight() - 1, 1);
+
+    std::vector<float> row_weights(m_n_rows);
+    std::vector<float> column_weights(m_n_columns);
+    m_column_distributions.resize(m_n_rows);
+    for (int j = 0; j < m_n_rows; ++j) {
+      // account for distortion of equirectangular projection
+      const float theta = M_PIf * (1.0f - (j + 0.5f) / m_n_rows);
+      const float sin_theta = glm::sin(theta);
+
+      float row_sum = 0.0f;
+      for (int i = 0; i < m_n_columns; ++i) {
+        column_weights[i] =
+            luminance(glm::vec3(m_texture.getPixel(i, j))) * sin_theta;
+        row_sum += column_weights[i];
+      }
+      row_weights[j] = row_sum;
+
+      // fall back to uniform when row is black, it is never selected anyway
+      if (row_sum <= 0.0f) {
+        std::fill(column_weights.begin(), column_weights.end(), 1.0f);
+      }
+      m_column_distributions[j] =
+          DiscreteDistribution1D(column_weights.data(), m_n_columns);
+    }
+
+    float sum = 0.0f;
+    for (int j = 0; j < m_n_rows; ++j) { sum += row_weights[j]; }
+    if (sum <= 0.0f) {
+      std::fill(row_weights.begin(), row_weights.end(), 1.0f);
+    }
+    m_row_distribution = DiscreteDistribution1D(row_weights.data(), m_n_rows);
+  }
+
+  // convert pmf of texel to pdf of solid angle measure
+  float texelPdf(float pmf, float theta) const
+  {
+    const float sin_theta = glm::sin(theta);
+    if (sin_theta == 0.0f) { return 0.0f; }
+    return pmf * m_n_columns * m_n_rows / (2.0f * M_PIf * M_PIf * sin_theta);
+  }
 };
\ No newline at end of file
@@ -32,6 +32,15 @@ class Texture
     return m_data[i + m_width * j];
   }
 
+  // get width of texture
+  int getWidth() const { return m_width; }
+
+  // get height of texture
+  int getHeight() const { return m_height; }
+
+  // get texel of (i, j)
+  glm::vec4 getPixel(int i, int j) const { return m_data[i + m_width * j]; }
+
  private:
   int m_width;                    // width of texture
   int m_height;                   // height of texture
@@ -0,0 +1,498 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "aov.h"
+#include "camera.h"
+#include "film.h"
+#include "filter.h"
+#include "glm/glm.hpp"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "sky.h"
+#include "spdlog/spdlog.h"
+
+// rectangular region of image [x0, x1) x [y0, y1)
+struct Tile {
+  int x0;
+  int y0;
+  int x1;
+  int y1;
+
+  int width() const { return x1 - x0; }
+  int height() const { return y1 - y0; }
+};
+
+// thread local accumulation buffer of one tile
+// sums are kept in double, so that precision isn't lost with high sample
+// counts, and rounded to float only once when they are added to image
+// with reconstruction filter, buffer has apron of pixels around tile, which
+// receive samples splatted over border of tile
+class TileAccumulator
+{
+ public:
+  // filter: reconstruction filter of splat, nullptr if only add is used
+  TileAccumulator(int tile_size, const Filter* filter = nullptr)
+      : m_filter(filter),
+        m_apron(filter != nullptr ? filter->getApron() : 0),
+        m_size(tile_size + 2 * m_apron),
+        m_sum(3 * m_size * m_size),
+        m_weight(filter != nullptr ? m_size * m_size : 0),
+        m_weight_x(2 * m_apron + 2),
+        m_weight_y(2 * m_apron + 2)
+  {
+  }
+
+  // start accumulation of tile
+  void reset(const Tile& tile)
+  {
+    m_tile = tile;
+    std::fill(m_sum.begin(), m_sum.end(), 0.0);
+    std::fill(m_weight.begin(), m_weight.end(), 0.0);
+  }
+
+  bool hasFilter() const { return m_filter != nullptr; }
+
+  // add radiance to pixel (i, j) of image, which must be inside of tile
+  void add(int i, int j, const glm::vec3& radiance)
+  {
+    double* sum = &m_sum[3 * index(i, j)];
+    sum[0] += radiance.x;
+    sum[1] += radiance.y;
+    sum[2] += radiance.z;
+  }
+
+  // splat radiance of sample at p to pixels whose center is within radius of
+  // filter, where p is position in pixels and must be inside of tile
+  // filter is separable, so that weights are evaluated once per row and column
+  void splat(const glm::vec2& p, const glm::vec3& radiance)
+  {
+    // range of pixels, where offset of sample from pixel center is in
+    // [-radius, radius)
+    const float radius = m_filter->getRadius();
+    const glm::vec2 p_min = glm::floor(p - 0.5f - radius) + 1.0f;
+    const glm::vec2 p_max = glm::floor(p - 0.5f + radius);
+    const int i0 = glm::max(static_cast<int>(p_min.x), m_tile.x0 - m_apron);
+    const int i1 = glm::min(static_cast<int>(p_max.x), m_tile.x1 - 1 + m_apron);
+    const int j0 = glm::max(static_cast<int>(p_min.y), m_tile.y0 - m_apron);
+    const int j1 = glm::min(static_cast<int>(p_max.y), m_tile.y1 - 1 + m_apron);
+
+    for (int i = i0; i <= i1; ++i) {
+      m_weight_x[i - i0] = m_filter->evaluate(p.x - (i + 0.5f));
+    }
+    for (int j = j0; j <= j1; ++j) {
+      m_weight_y[j - j0] = m_filter->evaluate(p.y - (j + 0.5f));
+    }
+
+    for (int j = j0; j <= j1; ++j) {
+      for (int i = i0; i <= i1; ++i) {
+        const float w = m_weight_x[i - i0] * m_weight_y[j - j0];
+        const int idx = index(i, j);
+        m_sum[3 * idx + 0] += w * radiance.x;
+        m_sum[3 * idx + 1] += w * radiance.y;
+        m_sum[3 * idx + 2] += w * radiance.z;
+        m_weight[idx] += w;
+      }
+    }
+  }
+
+  // add sums to image
+  // tiles don't overlap, so tiles can be flushed by threads in parallel
+  // without synchronization
+  // y_offset: row of whole image which is first row of image
+  void flush(Image& image, int y_offset = 0) const
+  {
+    for (int j = m_tile.y0; j < m_tile.y1; ++j) {
+      for (int i = m_tile.x0; i < m_tile.x1; ++i) {
+        const double* sum = &m_sum[3 * index(i, j)];
+        image.addPixel(i, j - y_offset, glm::vec3(sum[0], sum[1], sum[2]));
+      }
+    }
+  }
+
+  // add sums to RGB buffer of width x height image in double precision, so
+  // that partial sums added later are not rounded to float
+  void flush(std::vector<double>& buffer, int width) const
+  {
+    for (int j = m_tile.y0; j < m_tile.y1; ++j) {
+      for (int i = m_tile.x0; i < m_tile.x1; ++i) {
+        const double* sum = &m_sum[3 * index(i, j)];
+        double* dst = &buffer[3 * (i + width * j)];
+        dst[0] += sum[0];
+        dst[1] += sum[1];
+        dst[2] += sum[2];
+      }
+    }
+  }
+
+  // add sums of tile and apron to film, clipped to image
+  // aprons overlap neighboring tiles, so tiles flushed in parallel must be at
+  // least 2 aprons apart
+  void flush(Film& film) const
+  {
+    const int i0 = glm::max(m_tile.x0 - m_apron, 0);
+    const int i1 = glm::min(m_tile.x1 + m_apron, film.getWidth());
+    const int j0 = glm::max(m_tile.y0 - m_apron, 0);
+    const int j1 = glm::min(m_tile.y1 + m_apron, film.getHeight());
+    for (int j = j0; j < j1; ++j) {
+      for (int i = i0; i < i1; ++i) {
+        const int idx = index(i, j);
+        film.add(i, j,
+                 glm::vec3(m_sum[3 * idx + 0], m_sum[3 * idx + 1],
+                           m_sum[3 * idx + 2]),
+                 m_weight[idx]);
+      }
+    }
+  }
+
+ private:
+  const Filter* m_filter;         // reconstruction filter of splat
+  int m_apron;                    // width of apron around tile
+  int m_size;                     // width and height of buffer
+  Tile m_tile = {0, 0, 0, 0};     // tile being accumulated
+  std::vector<double> m_sum;      // sum of radiance(RGB) of tile pixels
+  std::vector<double> m_weight;   // sum of filter weights of tile pixels
+  std::vector<float> m_weight_x;  // filter weights of columns of splat
+  std::vector<float> m_weight_y;  // filter weights of rows of splat
+
+  // index of pixel (i, j) of image in buffer
+  int index(int i, int j) const
+  {
+    return (i - m_tile.x0 + m_apron) + m_size * (j - m_tile.y0 + m_apron);
+  }
+};
+
+// interleave lower 16 bits of x, y
+inline uint32_t morton_2d(uint32_t x, uint32_t y)
+{
+  const auto spread = [](uint32_t v) {
+    v &= 0x0000ffff;
+    v = (v | (v << 8)) & 0x00ff00ff;
+    v = (v | (v << 4)) & 0x0f0f0f0f;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+  };
+  return spread(x) | (spread(y) << 1);
+}
+
+// tile based parallel rendering with work stealing
+// tiles are sorted in morton order and each thread gets a contiguous range of
+// them, so that neighboring tiles are rendered by same thread. a thread which
+// finished its tiles steals tiles from the back of other threads' queues.
+class TileScheduler
+{
+ public:
+  TileScheduler(int width, int height, int tile_size = 16)
+      : m_width(width), m_height(height), m_tile_size(tile_size)
+  {
+    // make tiles
+    const int n_tiles_x = (width + tile_size - 1) / tile_size;
+    const int n_tiles_y = (height + tile_size - 1) / tile_size;
+    for (int ty = 0; ty < n_tiles_y; ++ty) {
+      for (int tx = 0; tx < n_tiles_x; ++tx) {
+        Tile tile;
+        tile.x0 = tx * tile_size;
+        tile.y0 = ty * tile_size;
+        tile.x1 = glm::min(tile.x0 + tile_size, width);
+        tile.y1 = glm::min(tile.y0 + tile_size, height);
+        m_tiles.push_back(tile);
+      }
+    }
+
+    // sort tiles in morton order
+    std::sort(m_tiles.begin(), m_tiles.end(),
+              [&](const Tile& t1, const Tile& t2) {
+                return morton_2d(t1.x0 / tile_size, t1.y0 / tile_size) <
+                       morton_2d(t2.x0 / tile_size, t2.y0 / tile_size);
+              });
+
+#ifdef _OPENMP
+    m_n_threads = omp_get_max_threads();
+#else
+    m_n_threads = 1;
+#endif
+    m_statistics.resize(m_n_threads);
+
+    spdlog::info("[TileScheduler] tile size: {}", m_tile_size);
+    spdlog::info("[TileScheduler] number of tiles: {}", m_tiles.size());
+    spdlog::info("[TileScheduler] number of threads: {}", m_n_threads);
+  }
+
+  // number of threads used in render
+  int getNumThreads() const { return m_n_threads; }
+
+  // keep only rank-th of n_ranks contiguous ranges of tiles, so that
+  // processes of distributed rendering render disjoint tile sets
+  void partition(int rank, int n_ranks)
+  {
+    const size_t begin = m_tiles.size() * rank / n_ranks;
+    const size_t end = m_tiles.size() * (rank + 1) / n_ranks;
+    m_tiles = std::vector<Tile>(m_tiles.begin() + begin,
+                                m_tiles.begin() + end);
+
+    spdlog::info("[TileScheduler] partition {}/{}: {} tiles", rank, n_ranks,
+                 m_tiles.size());
+  }
+
+  // render all tiles in parallel
+  // f(tile, thread_id, accumulation) renders one tile. accumulation is
+  // thread local TileAccumulator of the tile, which is added to image after f
+  // returns.
+  // busy time of each thread is accumulated, see logStatistics
+  template <typename F>
+  void render(Image& image, F f)
+  {
+    std::vector<uint32_t> tiles(m_tiles.size());
+    for (size_t k = 0; k < m_tiles.size(); ++k) { tiles[k] = k; }
+    renderTiles(tiles, nullptr, f, [&](const TileAccumulator& accumulation) {
+      accumulation.flush(image);
+    });
+  }
+
+  // same as render to image, but sums are added to RGB buffer of whole image
+  // in double precision, which has 3 * width * height elements
+  template <typename F>
+  void render(std::vector<double>& buffer, F f)
+  {
+    std::vector<uint32_t> tiles(m_tiles.size());
+    for (size_t k = 0; k < m_tiles.size(); ++k) { tiles[k] = k; }
+    renderTiles(tiles, nullptr, f, [&](const TileAccumulator& accumulation) {
+      accumulation.flush(buffer, m_width);
+    });
+  }
+
+  // render all tiles in parallel, and splat samples to film with its
+  // reconstruction filter
+  // f is same as render, but it splats samples with accumulation.splat.
+  // aprons overlap neighboring tiles, so tiles are rendered in 4 passes of
+  // every other tile in x and y, in which aprons don't overlap. tiles are
+  // flushed without synchronization, and result doesn't depend on number of
+  // threads.
+  template <typename F>
+  void render(Film& film, F f)
+  {
+    const Filter& filter = film.getFilter();
+    if (2 * filter.getApron() > m_tile_size) {
+      throw std::runtime_error("filter radius is too large for tile size");
+    }
+
+    for (int pass = 0; pass < 4; ++pass) {
+      // tiles of pass, which keep morton order
+      std::vector<uint32_t> tiles;
+      for (size_t k = 0; k < m_tiles.size(); ++k) {
+        const int tx = m_tiles[k].x0 / m_tile_size;
+        const int ty = m_tiles[k].y0 / m_tile_size;
+        if ((tx & 1) + 2 * (ty & 1) == pass) { tiles.push_back(k); }
+      }
+
+      renderTiles(tiles, &filter, f,
+                  [&](const TileAccumulator& accumulation) {
+                    accumulation.flush(film);
+                  });
+    }
+  }
+
+  // render image in bands of rows from top to bottom
+  // band is rendered same as render, and output(band, y0) is called when all
+  // tiles of the band are done, where y0 is row of first row of band. only one
+  // band is kept in memory, so that image larger than memory can be rendered
+  // with output which writes rows to file.
+  // band_rows: number of rows of band, rounded up to multiple of tile size
+  template <typename F, typename G>
+  void renderBands(int band_rows, F f, G output)
+  {
+    band_rows = glm::max(band_rows, 1);
+    band_rows = (band_rows + m_tile_size - 1) / m_tile_size * m_tile_size;
+
+    for (int y0 = 0; y0 < m_height; y0 += band_rows) {
+      const int y1 = glm::min(y0 + band_rows, m_height);
+
+      // tiles of band, which keep morton order
+      std::vector<uint32_t> tiles;
+      for (size_t k = 0; k < m_tiles.size(); ++k) {
+        if (m_tiles[k].y0 >= y0 && m_tiles[k].y0 < y1) {
+          tiles.push_back(k);
+        }
+      }
+
+      Image band(m_width, y1 - y0);
+      renderTiles(tiles, nullptr, f,
+                  [&](const TileAccumulator& accumulation) {
+                    accumulation.flush(band, y0);
+                  });
+      output(band, y0);
+    }
+  }
+
+  // log busy time of each thread accumulated over all renders
+  void logStatistics() const
+  {
+    double busy_max = 0.0;
+    double busy_sum = 0.0;
+    for (int t = 0; t < m_n_threads; ++t) {
+      const ThreadStatistics& stats = m_statistics[t];
+      spdlog::info("[TileScheduler] thread {}: busy {:.3f}s, {} tiles({} stolen)",
+                   t, stats.busy_time, stats.n_tiles, stats.n_stolen_tiles);
+      busy_max = glm::max(busy_max, stats.busy_time);
+      busy_sum += stats.busy_time;
+    }
+    if (busy_max > 0.0) {
+      spdlog::info("[TileScheduler] load balance(mean / max busy time): {:.3f}",
+                   busy_sum / m_n_threads / busy_max);
+    }
+  }
+
+ private:
+  // tiles of one thread
+  struct alignas(64) WorkQueue {
+    std::mutex mutex;
+    std::deque<uint32_t> tiles;
+  };
+
+  struct ThreadStatistics {
+    double busy_time = 0.0;   // time spent on rendering tiles
+    int n_tiles = 0;          // number of rendered tiles
+    int n_stolen_tiles = 0;   // number of tiles stolen from other threads
+  };
+
+  int m_width;                // width of image
+  int m_height;               // height of image
+  int m_tile_size;            // width and height of tile
+  int m_n_threads;            // number of threads
+  std::vector<Tile> m_tiles;  // tiles in morton order
+
+  std::vector<ThreadStatistics> m_statistics;  // statistics of each thread
+
+  // render tiles in parallel with work stealing
+  // tiles: indices of tiles to render
+  // filter: reconstruction filter of accumulators, nullptr if not splatted
+  // flush(accumulation) adds accumulation of rendered tile to output
+  template <typename F, typename G>
+  void renderTiles(const std::vector<uint32_t>& tiles, const Filter* filter,
+                   F f, G flush)
+  {
+    // distribute tiles to threads
+    std::vector<WorkQueue> queues(m_n_threads);
+    for (int t = 0; t < m_n_threads; ++t) {
+      const size_t begin = tiles.size() * t / m_n_threads;
+      const size_t end = tiles.size() * (t + 1) / m_n_threads;
+      for (size_t k = begin; k < end; ++k) {
+        queues[t].tiles.push_back(tiles[k]);
+      }
+    }
+
+#pragma omp parallel num_threads(m_n_threads)
+    {
+#ifdef _OPENMP
+      const int thread_id = omp_get_thread_num();
+#else
+      const int thread_id = 0;
+#endif
+      ThreadStatistics& stats = m_statistics[thread_id];
+      TileAccumulator accumulation(m_tile_size, filter);
+
+      uint32_t tile_idx;
+      bool stolen;
+      while (nextTile(queues, thread_id, tile_idx, stolen)) {
+        const auto start = std::chrono::steady_clock::now();
+
+        const Tile& tile = m_tiles[tile_idx];
+        accumulation.reset(tile);
+        f(tile, thread_id, accumulation);
+        flush(accumulation);
+
+        stats.busy_time += std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+        stats.n_tiles++;
+        if (stolen) { stats.n_stolen_tiles++; }
+      }
+    }
+  }
+
+  // pop tile from own queue, or steal from other threads
+  // return: false if no tile is left
+  bool nextTile(std::vector<WorkQueue>& queues, int thread_id,
+                uint32_t& tile_idx, bool& stolen) const
+  {
+    // pop from front of own queue
+    {
+      WorkQueue& queue = queues[thread_id];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tiles.empty()) {
+        tile_idx = queue.tiles.front();
+        queue.tiles.pop_front();
+        stolen = false;
+        return true;
+      }
+    }
+
+    // steal from back of other queues, which is far from their current tile
+    for (int k = 1; k < m_n_threads; ++k) {
+      WorkQueue& queue = queues[(thread_id + k) % m_n_threads];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tiles.empty()) {
+        tile_idx = queue.tiles.back();
+        queue.tiles.pop_back();
+        stolen = true;
+        return true;
+      }
+    }
+
+    return false;
+  }
+};
+
+// render samples [sample_start, sample_end) of pixel (i, j) of width x height
+// image, and add them to accumulation. samples are splatted if accumulation
+// has filter.
+// aov: AOVs of each sample are added if not nullptr
+template <typename SamplerT>
+inline void render_pixel(int i, int j, uint32_t sample_start,
+                         uint32_t sample_end, int width, int height,
+                         const Camera& camera, const Integrator& integrator,
+                         const Intersector& intersector, const Sky& sky,
+                         SamplerT& sampler, TileAccumulator& accumulation,
+                         AOVBuffer* aov = nullptr)
+{
+  for (uint32_t k = sample_start; k < sample_end; ++k) {
+    sampler.startPixelSample(i + width * j, k);
+
+    const glm::vec2 p_film = glm::vec2(i, j) + sampler.next_2d();
+    glm::vec2 ndc = glm::vec2((2.0f * p_film.x - width) / height,
+                              (2.0f * p_film.y - height) / height);
+    ndc.y *= -1.0f;
+
+    // sample ray from camera
+    const Ray ray = camera.sampleRay(ndc, sampler.next_2d());
+
+    // evaluate incoming radiance and AOVs
+    glm::vec3 radiance;
+    if (aov != nullptr) {
+      AOVSample aov_sample(aov->getMask());
+      radiance =
+          integrator.integrate(ray, intersector, sky, sampler, &aov_sample);
+      aov->addSample(i, j, aov_sample);
+    } else {
+      radiance = integrator.integrate(ray, intersector, sky, sampler);
+    }
+
+    if (isinf(radiance) || isnan(radiance)) { continue; }
+    if (accumulation.hasFilter()) {
+      accumulation.splat(p_film, radiance);
+    } else {
+      accumulation.add(i, j, radiance);
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,424 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "bsdf.h"
+#include "camera.h"
+#include "core.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "light.h"
+#include "sampler.h"
+#include "sky.h"
+
+// wavefront path tracing
+// instead of tracing whole path of one pixel sample at once, paths of all
+// pixels are advanced together bounce by bounce through separate stages.
+// each stage runs one kind of work over a queue of path ids, which keeps
+// instruction and data cache warm.
+// generate -> (extend -> shade -> shadow) x max_depth -> accumulate
+// Laine, S., Karras, T., & Aila, T. (2013). Megakernels considered harmful:
+// wavefront path tracing on GPUs.
+//
+// it computes the same estimator as PathTracingNEE, or PathTracing when
+// light_sampler is nullptr. stages share per-path functions with integrate(),
+// which traces one path through them like the other integrators.
+class WavefrontPathTracing : public Integrator
+{
+ public:
+  WavefrontPathTracing(uint32_t max_depth,
+                       const LightSampler* light_sampler = nullptr,
+                       bool sort_rays = false, bool sort_hits = false)
+      : m_max_depth(max_depth),
+        m_light_sampler(light_sampler),
+        m_sort_rays(sort_rays),
+        m_sort_hits(sort_hits)
+  {
+  }
+
+  // trace one path through the stages
+  glm::vec3 integrate(const Ray& ray, const Intersector& intersector,
+                      const Sky& sky, Sampler& sampler,
+                      AOVSample* aov = nullptr) const override
+  {
+    glm::vec3 origin = ray.origin;
+    glm::vec3 direction = ray.direction;
+    glm::vec3 throughput(1.0f);
+    glm::vec3 radiance(0.0f);
+
+    for (int depth = 0; depth < m_max_depth; ++depth) {
+      IntersectInfo info;
+      if (!extendPath(Ray(origin, direction), intersector, sky, sampler,
+                      depth, throughput, radiance, info, aov)) {
+        break;
+      }
+
+      glm::vec3 shadow_direction, shadow_contribution;
+      float shadow_tmax;
+      const bool has_shadow =
+          shadePath(info, sampler, depth, origin, direction, throughput,
+                    shadow_direction, shadow_tmax, shadow_contribution);
+      if (has_shadow) {
+        radiance += shadowPath(intersector, origin, shadow_direction,
+                               shadow_tmax, shadow_contribution);
+      }
+    }
+
+    return radiance;
+  }
+
+  // render n_samples per pixel and add radiance to image
+  // image is not divided by n_samples
+  // sampler: prototype of sampler, copied per path
+  template <typename SamplerT>
+  void render(const Camera& camera, const Intersector& intersector,
+              const Sky& sky, const SamplerT& sampler, int n_samples,
+              Image& image)
+  {
+    const int width = image.getWidth();
+    const int height = image.getHeight();
+    const uint32_t n_paths = width * height;
+    resize(n_paths);
+
+    std::vector<SamplerT> samplers(n_paths, sampler);
+
+    for (int k = 0; k < n_samples; ++k) {
+      generate(camera, samplers.data(), width, height, k);
+
+      for (int depth = 0; depth < m_max_depth && !m_ray_queue.empty();
+           ++depth) {
+        if (m_sort_rays) { sortRays(); }
+        extend(intersector, sky, samplers.data(), depth);
+        if (m_sort_hits) { sortHits(); }
+        shade(intersector, samplers.data(), depth);
+        shadow(intersector);
+      }
+
+      accumulate(image, width);
+    }
+  }
+
+ private:
+  uint32_t m_max_depth;                 // maximum ray depth
+  const LightSampler* m_light_sampler;  // used for NEE, nullptr disables NEE
+  bool m_sort_rays;                     // sort rays before extend stage
+  bool m_sort_hits;                     // sort hits before shade stage
+
+  // path states(SoA), indexed by path id
+  std::vector<glm::vec3> m_ray_origin;
+  std::vector<glm::vec3> m_ray_direction;
+  std::vector<glm::vec3> m_throughput;
+  std::vector<glm::vec3> m_radiance;
+  std::vector<IntersectInfo> m_hit;
+
+  // shadow rays(SoA), indexed by path id
+  std::vector<glm::vec3> m_shadow_direction;
+  std::vector<float> m_shadow_tmax;
+  std::vector<glm::vec3> m_shadow_contribution;
+
+  // queues of path ids
+  std::vector<uint32_t> m_ray_queue;     // paths to be extended
+  std::vector<uint32_t> m_hit_queue;     // paths to be shaded
+  std::vector<uint32_t> m_shadow_queue;  // paths with shadow ray
+  std::vector<uint8_t> m_flags;          // per-path flag used by compaction
+
+  // sort keys(key, path id)
+  std::vector<uint64_t> m_sort_keys;
+
+  void resize(uint32_t n_paths)
+  {
+    m_ray_origin.resize(n_paths);
+    m_ray_direction.resize(n_paths);
+    m_throughput.resize(n_paths);
+    m_radiance.resize(n_paths);
+    m_hit.resize(n_paths);
+    m_shadow_direction.resize(n_paths);
+    m_shadow_tmax.resize(n_paths);
+    m_shadow_contribution.resize(n_paths);
+    m_flags.resize(n_paths);
+    m_ray_queue.reserve(n_paths);
+    m_hit_queue.reserve(n_paths);
+    m_shadow_queue.reserve(n_paths);
+    m_sort_keys.reserve(n_paths);
+  }
+
+  // keep ids in queue whose flag is set, preserving order
+  void compact(const std::vector<uint32_t>& in, std::vector<uint32_t>& out)
+  {
+    out.clear();
+    for (const uint32_t id : in) {
+      if (m_flags[id]) { out.push_back(id); }
+    }
+  }
+
+  // sort queue by key, ties are broken by path id
+  template <typename F>
+  void sortQueue(std::vector<uint32_t>& queue, F key)
+  {
+    m_sort_keys.resize(queue.size());
+#pragma omp parallel for
+    for (int q = 0; q < queue.size(); ++q) {
+      m_sort_keys[q] = (static_cast<uint64_t>(key(queue[q])) << 32) | queue[q];
+    }
+    std::sort(m_sort_keys.begin(), m_sort_keys.end());
+    for (int q = 0; q < queue.size(); ++q) {
+      queue[q] = static_cast<uint32_t>(m_sort_keys[q]);
+    }
+  }
+
+  // generate camera rays of all pixels
+  template <typename SamplerT>
+  void generate(const Camera& camera, SamplerT* samplers, int width,
+                int height, int sample_index)
+  {
+    const uint32_t n_paths = width * height;
+    m_ray_queue.resize(n_paths);
+
+#pragma omp parallel for
+    for (int id = 0; id < n_paths; ++id) {
+      const int i = id % width;
+      const int j = id / width;
+
+      SamplerT& sampler = samplers[id];
+      sampler.startPixelSample(id, sample_index);
+
+      const glm::vec2 u_pixel = sampler.next_2d();
+      glm::vec2 ndc = glm::vec2((2.0f * (i + u_pixel.x) - width) / height,
+                                (2.0f * (j + u_pixel.y) - height) / height);
+      ndc.y *= -1.0f;
+
+      const Ray ray = camera.sampleRay(ndc, sampler.next_2d());
+      m_ray_origin[id] = ray.origin;
+      m_ray_direction[id] = ray.direction;
+      m_throughput[id] = glm::vec3(1.0f);
+      m_radiance[id] = glm::vec3(0.0f);
+      m_ray_queue[id] = id;
+    }
+  }
+
+  // sort rays by direction octant, then by origin cell to improve coherence
+  // of bvh traversal
+  void sortRays()
+  {
+    sortQueue(m_ray_queue, [&](uint32_t id) {
+      const glm::vec3& d = m_ray_direction[id];
+      const uint32_t octant = (d.x < 0.0f ? 1 : 0) | (d.y < 0.0f ? 2 : 0) |
+                              (d.z < 0.0f ? 4 : 0);
+      const glm::vec3& o = m_ray_origin[id];
+      const uint32_t cell = hash_combine(
+          hash_combine(hash_u32(static_cast<int>(glm::floor(o.x))),
+                       static_cast<int>(glm::floor(o.y))),
+          static_cast<int>(glm::floor(o.z)));
+      return (octant << 29) | (cell >> 3);
+    });
+  }
+
+  // sort hits by material, so that shade stage fetches same textures and
+  // material parameters in a row
+  void sortHits()
+  {
+    sortQueue(m_hit_queue, [&](uint32_t id) {
+      const Material* material = m_hit[id].primitive->material;
+      return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(material) >> 3);
+    });
+  }
+
+  // russian roulette and find closest intersection
+  template <typename SamplerT>
+  void extend(const Intersector& intersector, const Sky& sky,
+              SamplerT* samplers, int depth)
+  {
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int q = 0; q < m_ray_queue.size(); ++q) {
+      const uint32_t id = m_ray_queue[q];
+      m_hit[id] = IntersectInfo();
+      m_flags[id] = extendPath(Ray(m_ray_origin[id], m_ray_direction[id]),
+                               intersector, sky, samplers[id], depth,
+                               m_throughput[id], m_radiance[id], m_hit[id]);
+    }
+
+    compact(m_ray_queue, m_hit_queue);
+  }
+
+  // extend stage of one path
+  // return: true if path hits surface to be shaded
+  template <typename SamplerT>
+  bool extendPath(const Ray& ray, const Intersector& intersector,
+                  const Sky& sky, SamplerT& sampler, int depth,
+                  glm::vec3& throughput, glm::vec3& radiance,
+                  IntersectInfo& info, AOVSample* aov = nullptr) const
+  {
+    // russian roulette
+    const float russian_roulette_prob = glm::min(
+        glm::max(throughput.x, glm::max(throughput.y, throughput.z)), 1.0f);
+    if (sampler.next_1d() > russian_roulette_prob) { return false; }
+    throughput /= russian_roulette_prob;
+
+    const bool hit = (depth == 0 && aov != nullptr)
+                         ? aov->intersectFirstHit(ray, intersector, info)
+                         : intersector.intersect(ray, info);
+    if (depth == 0 && aov != nullptr) {
+      aov->setFirstHit(ray, hit, info, intersector, sky);
+    }
+
+    if (!hit) {
+      // ray goes to sky
+      // evaluate environment light
+      radiance += throughput * sky.evaluate(ray);
+      return false;
+    }
+
+    if (info.primitive->has_emission()) {
+      // ray hits area light
+      // with NEE, add Le only for camera ray to avoid double counting
+      if (m_light_sampler == nullptr || depth == 0) {
+        radiance += throughput * info.primitive->material->emission_color;
+      }
+      return false;
+    }
+
+    return true;
+  }
+
+  // evaluate BSDF, sample light and next direction
+  template <typename SamplerT>
+  void shade(const Intersector& intersector, SamplerT* samplers, int depth)
+  {
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int q = 0; q < m_hit_queue.size(); ++q) {
+      const uint32_t id = m_hit_queue[q];
+      m_flags[id] =
+          shadePath(m_hit[id], samplers[id], depth, m_ray_origin[id],
+                    m_ray_direction[id], m_throughput[id],
+                    m_shadow_direction[id], m_shadow_tmax[id],
+                    m_shadow_contribution[id]);
+    }
+
+    compact(m_hit_queue, m_shadow_queue);
+    m_ray_queue.swap(m_hit_queue);
+  }
+
+  // shade stage of one path, ray is replaced by the next ray
+  // return: true if shadow ray needs to be traced
+  template <typename SamplerT>
+  bool shadePath(const IntersectInfo& info, SamplerT& sampler, int depth,
+                 glm::vec3& ray_origin, glm::vec3& ray_direction,
+                 glm::vec3& throughput, glm::vec3& shadow_direction,
+                 float& shadow_tmax, glm::vec3& shadow_contribution) const
+  {
+    // compute tangent space basis
+    glm::vec3 tangent, bitangent;
+    orthonormal_basis(info.normal, tangent, bitangent);
+
+    // setup BSDF
+    const auto bsdf = DiffuseSpecularMetal(info);
+
+    const glm::vec3 wo =
+        world_to_local(-ray_direction, tangent, info.normal, bitangent);
+    const glm::vec3 origin = info.position + RAY_EPS * info.normal;
+
+    // next event estimation
+    // shadow ray is traced later in shadow stage
+    bool has_shadow = false;
+    if (m_light_sampler != nullptr && depth + 1 < m_max_depth) {
+      has_shadow = sampleLight(origin, wo, tangent, info.normal, bitangent,
+                               bsdf, throughput, sampler, shadow_direction,
+                               shadow_tmax, shadow_contribution);
+    }
+
+    // sample direction from BSDF
+    glm::vec3 f;
+    float pdf;
+    const glm::vec3 wi = bsdf.sampleDirection(sampler.next_2d(),
+                                              sampler.next_1d(), wo, f, pdf);
+
+    // update throughput
+    throughput *= f * abs_cos_theta(wi) / pdf;
+
+    // update ray
+    ray_origin = origin;
+    ray_direction = local_to_world(wi, tangent, info.normal, bitangent);
+
+    return has_shadow;
+  }
+
+  // sample point on light and make shadow ray
+  // return: true if shadow ray needs to be traced
+  template <typename SamplerT>
+  bool sampleLight(const glm::vec3& origin, const glm::vec3& wo,
+                   const glm::vec3& t, const glm::vec3& n, const glm::vec3& b,
+                   const BSDF& bsdf, const glm::vec3& throughput,
+                   SamplerT& sampler, glm::vec3& shadow_direction,
+                   float& shadow_tmax, glm::vec3& shadow_contribution) const
+  {
+    // select light
+    float light_pmf;
+    const AreaLight* light =
+        m_light_sampler->sample(origin, sampler.next_1d(), light_pmf);
+    const glm::vec2 u = sampler.next_2d();
+    if (light == nullptr || light_pmf == 0.0f) { return false; }
+
+    // sample point on light
+    glm::vec3 light_normal;
+    float light_pdf;
+    const glm::vec3 p_light = light->samplePoint(u, light_normal, light_pdf);
+
+    // convert pdf from area measure to solid angle measure
+    const glm::vec3 d = p_light - origin;
+    const float dist2 = glm::dot(d, d);
+    const float dist = glm::sqrt(dist2);
+    const glm::vec3 wi_world = d / dist;
+    const float cos_light = glm::abs(glm::dot(light_normal, wi_world));
+    if (cos_light == 0.0f) { return false; }
+    const float pdf = light_pmf * light_pdf * dist2 / cos_light;
+
+    // evaluate BSDF
+    const glm::vec3 wi = world_to_local(wi_world, t, n, b);
+    const glm::vec3 f = bsdf.evaluate(wo, wi);
+    if (f == glm::vec3(0.0f)) { return false; }
+
+    shadow_direction = wi_world;
+    shadow_tmax = dist - RAY_EPS;
+    shadow_contribution =
+        throughput * f * abs_cos_theta(wi) * light->Le() / pdf;
+    return true;
+  }
+
+  // trace shadow rays, origin is shared with the next ray
+  void shadow(const Intersector& intersector)
+  {
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int q = 0; q < m_shadow_queue.size(); ++q) {
+      const uint32_t id = m_shadow_queue[q];
+      m_radiance[id] +=
+          shadowPath(intersector, m_ray_origin[id], m_shadow_direction[id],
+                     m_shadow_tmax[id], m_shadow_contribution[id]);
+    }
+  }
+
+  // shadow stage of one path
+  // return: contribution if light is visible
+  glm::vec3 shadowPath(const Intersector& intersector,
+                       const glm::vec3& origin, const glm::vec3& direction,
+                       float tmax, const glm::vec3& contribution) const
+  {
+    Ray shadow_ray(origin, direction);
+    shadow_ray.tmax = tmax;
+    if (intersector.occluded(shadow_ray)) { return glm::vec3(0.0f); }
+    return contribution;
+  }
+
+  // add radiance of all paths to image
+  void accumulate(Image& image, int width)
+  {
+#pragma omp parallel for
+    for (int id = 0; id < m_radiance.size(); ++id) {
+      const glm::vec3& radiance = m_radiance[id];
+      if (!isinf(radiance) && !isnan(radiance)) {
+        image.addPixel(id % width, id / width, radiance);
+      }
+    }
+  }
+};
\ No newline at end of file
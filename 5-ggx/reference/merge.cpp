@@ -0,0 +1,68 @@
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "accumulation.h"
+#include "image.h"
+#include "io.h"
+
+// combine accumulations written by distributed into final image
+// usage: merge <output> <input>...
+// output format is chosen by extension(.png, .exr or .pfm)
+int main(int argc, char** argv)
+{
+  if (argc < 3) {
+    spdlog::error("usage: {} <output> <input>...", argv[0]);
+    return EXIT_FAILURE;
+  }
+  const std::string output_filename = argv[1];
+
+  try {
+    std::vector<Accumulation> inputs;
+    for (int k = 2; k < argc; ++k) {
+      inputs.push_back(read_accumulation(argv[k]));
+    }
+
+    // reject duplicate inputs and inputs rendering same samples
+    for (size_t a = 0; a < inputs.size(); ++a) {
+      for (size_t b = a + 1; b < inputs.size(); ++b) {
+        if (inputs[a].overlaps(inputs[b])) {
+          throw std::runtime_error(std::string(argv[a + 2]) + " and " +
+                                   argv[b + 2] + " have same samples");
+        }
+      }
+    }
+
+    Accumulation accumulation = inputs[0];
+    for (size_t k = 1; k < inputs.size(); ++k) {
+      accumulation.merge(inputs[k]);
+    }
+    spdlog::info("[merge] merged {} accumulations", inputs.size());
+
+    Image image(accumulation.width, accumulation.height);
+    const uint32_t n_empty = accumulation.resolve(image);
+    if (n_empty > 0) {
+      spdlog::warn("[merge] {} pixels have no samples", n_empty);
+    }
+
+    // hdr formats keep linear radiance
+    const std::string extension =
+        std::filesystem::path(output_filename).extension();
+    if (extension == ".exr") {
+      write_exr(output_filename, image.getWidth(), image.getHeight(),
+                image.getConstPtr());
+    } else if (extension == ".pfm") {
+      write_pfm(output_filename, image.getWidth(), image.getHeight(),
+                image.getConstPtr());
+    } else {
+      write_png(output_filename, image.getWidth(), image.getHeight(),
+                image.getConstPtr(), PostProcess());
+    }
+  } catch (const std::exception& e) {
+    spdlog::error("[merge] {}", e.what());
+    return EXIT_FAILURE;
+  }
+
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "bsdf.h"
+#include "camera.h"
+#include "core.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "io.h"
+#include "light.h"
+#include "primitive.h"
+#include "sampler.h"
+#include "scene.h"
+#include "tile.h"
+
+int main()
+{
+  const int width = 512;
+  const int height = 512;
+  const int n_samples = 100;
+  const int max_depth = 10;
+  const int tile_size = 16;
+
+  Image image(width, height);
+  PinholeCamera camera(glm::vec3(0, 1, 3), glm::vec3(0, 0, -1), 0.33f * M_PIf);
+
+  Scene scene;
+  scene.loadObj("./CornellBox.obj");
+
+  BVHOptimized intersector(scene.m_primitives.data(),
+                           scene.m_primitives.size());
+  intersector.buildBVH();
+
+  IBL sky("PaperMill_E_3k.hdr");
+
+  SobolSampler sampler(12);
+
+  PowerLightSampler light_sampler(scene.m_lights.data(),
+                                  scene.m_lights.size());
+
+  PathTracingNEE integrator(max_depth, &light_sampler);
+
+  TileScheduler scheduler(width, height, tile_size);
+  std::vector<SobolSampler> samplers(scheduler.getNumThreads(), sampler);
+
+  scheduler.render(image, [&](const Tile& tile, int thread_id,
+                              TileAccumulator& accumulation) {
+    SobolSampler& sampler = samplers[thread_id];
+    for (int j = tile.y0; j < tile.y1; ++j) {
+      for (int i = tile.x0; i < tile.x1; ++i) {
+        render_pixel(i, j, 0, n_samples, width, height, camera, integrator,
+                     intersector, sky, sampler, accumulation);
+      }
+    }
+  });
+  scheduler.logStatistics();
+  image.divide(n_samples);
+
+  write_png("output.png", width, height, image.getConstPtr(), PostProcess());
+
+  return 0;
+}
\ No newline at end of file
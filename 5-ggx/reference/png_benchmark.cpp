@@ -0,0 +1,86 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#include "io.h"
+#include "spdlog/spdlog.h"
+#include "stb_image_write.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// measure seconds taken by f
+template <typename F>
+double benchmark(F f)
+{
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// size of file in bytes
+size_t file_size(const char* filename)
+{
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  return file.is_open() ? static_cast<size_t>(file.tellg()) : 0;
+}
+
+// compare png encode time and size of stb_image_write and write_png_rgb8
+// write_png_rgb8 is measured with one thread and all threads, while
+// stb_image_write is single threaded.
+int main()
+{
+  const int width = 4096;
+  const int height = 4096;
+
+  int n_threads = 1;
+#ifdef _OPENMP
+  n_threads = omp_get_max_threads();
+#endif
+  spdlog::info("[png_benchmark] number of threads: {}", n_threads);
+
+  // smooth gradient with sparse noise, which resembles rendered image
+  std::vector<unsigned char> image(3 * width * height);
+  uint32_t state = 1;
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      for (int c = 0; c < 3; ++c) {
+        state = 1664525u * state + 1013904223u;
+        const float v = 128.0f + 100.0f * std::sin(0.001f * i + c) *
+                                     std::cos(0.0013f * j);
+        image[3 * (i + width * j) + c] = v + ((state >> 28) == 0);
+      }
+    }
+  }
+
+  const double stb_time = benchmark([&]() {
+    stbi_write_png("stb.png", width, height, 3, image.data(), 3 * width);
+  });
+  spdlog::info("[png_benchmark] stb_image_write: {:.3f}s, {} bytes", stb_time,
+               file_size("stb.png"));
+
+  for (const int level : {1, 6}) {
+    for (const int threads : {1, n_threads}) {
+#ifdef _OPENMP
+      omp_set_num_threads(threads);
+#endif
+      const double time = benchmark([&]() {
+        write_png_rgb8("parallel.png", width, height, image.data(), level);
+      });
+      spdlog::info(
+          "[png_benchmark] write_png_rgb8 level {}, {} threads: {:.3f}s"
+          "({:.2f}x), {} bytes",
+          level, threads, time, stb_time / time, file_size("parallel.png"));
+      if (n_threads == 1) { break; }
+    }
+  }
+#ifdef _OPENMP
+  omp_set_num_threads(n_threads);
+#endif
+
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "bsdf.h"
+#include "camera.h"
+#include "core.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "primitive.h"
+#include "sampler.h"
+#include "scanline_writer.h"
+#include "scene.h"
+#include "tile.h"
+
+// render image larger than memory
+// image is rendered in bands of rows, and each band is post processed and
+// appended to output as soon as it is done, so that only one band of rows is
+// kept in memory
+// usage: poster <width> <height> <output> [n_samples]
+// output format is chosen by extension(.png, .ppm or .exr)
+int main(int argc, char** argv)
+{
+  if (argc < 4) {
+    spdlog::error("usage: {} <width> <height> <output> [n_samples]", argv[0]);
+    return EXIT_FAILURE;
+  }
+  const int width = std::stoi(argv[1]);
+  const int height = std::stoi(argv[2]);
+  const std::string output_filename = argv[3];
+  const int n_samples = argc > 4 ? std::stoi(argv[4]) : 16;
+  const int max_depth = 10;
+  const int tile_size = 16;
+  const int band_rows = 64;
+
+  PinholeCamera camera(glm::vec3(0, 1, 3), glm::vec3(0, 0, -1), 0.33f * M_PIf);
+
+  Scene scene;
+  scene.loadObj("./CornellBox.obj");
+
+  BVHOptimized intersector(scene.m_primitives.data(),
+                           scene.m_primitives.size());
+  intersector.buildBVH();
+
+  IBL sky("PaperMill_E_3k.hdr");
+
+  SobolSampler sampler(12);
+
+  PathTracing integrator(max_depth);
+
+  TileScheduler scheduler(width, height, tile_size);
+  std::vector<SobolSampler> samplers(scheduler.getNumThreads(), sampler);
+
+  try {
+    std::unique_ptr<ScanlineWriter> writer =
+        make_scanline_writer(output_filename, width, height);
+
+    scheduler.renderBands(
+        band_rows,
+        [&](const Tile& tile, int thread_id, TileAccumulator& accumulation) {
+          SobolSampler& sampler = samplers[thread_id];
+          for (int j = tile.y0; j < tile.y1; ++j) {
+            for (int i = tile.x0; i < tile.x1; ++i) {
+              render_pixel(i, j, 0, n_samples, width, height, camera,
+                           integrator, intersector, sky, sampler,
+                           accumulation);
+            }
+          }
+        },
+        [&](Image& band, int y0) {
+          band.divide(n_samples);
+          writer->writeRows(band.getConstPtr(), band.getHeight());
+          spdlog::info("[poster] {}/{} rows", y0 + band.getHeight(), height);
+        });
+
+    writer->close();
+  } catch (const std::exception& e) {
+    spdlog::error("[poster] {}", e.what());
+    return EXIT_FAILURE;
+  }
+  scheduler.logStatistics();
+
+  return 0;
+}
\ No newline at end of file
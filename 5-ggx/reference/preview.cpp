@@ -0,0 +1,74 @@
+#include "bluenoise.h"
+#include "bsdf.h"
+#include "camera.h"
+#include "core.h"
+#include "denoiser.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "io.h"
+#include "primitive.h"
+#include "sampler.h"
+#include "scene.h"
+
+int main()
+{
+  const int width = 512;
+  const int height = 512;
+  const int n_samples = 4;
+  const int max_depth = 10;
+
+  Image image(width, height);
+  AOVBuffer aov(width, height, Denoiser::getRequiredAOVs());
+  PinholeCamera camera(glm::vec3(0, 1, 3), glm::vec3(0, 0, -1), 0.33f * M_PIf);
+
+  Scene scene;
+  scene.loadObj("./CornellBox.obj");
+
+  BVHOptimized intersector(scene.m_primitives.data(),
+                           scene.m_primitives.size());
+  intersector.buildBVH();
+
+  IBL sky("PaperMill_E_3k.hdr");
+
+  BlueNoiseTile tile(64);
+  BlueNoiseSampler sampler(12, &tile, width);
+
+  PathTracing integrator(max_depth);
+
+#pragma omp parallel for collapse(2) firstprivate(sampler)
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      for (int k = 0; k < n_samples; ++k) {
+        sampler.startPixelSample(i + width * j, k);
+
+        const glm::vec2 u_pixel = sampler.next_2d();
+        glm::vec2 ndc = glm::vec2((2.0f * (i + u_pixel.x) - width) / height,
+                                  (2.0f * (j + u_pixel.y) - height) / height);
+        ndc.y *= -1.0f;
+
+        // sample ray from camera
+        const Ray ray = camera.sampleRay(ndc, sampler.next_2d());
+
+        // evaluate incoming radiance and AOVs guiding denoiser
+        AOVSample aov_sample(aov.getMask());
+        const glm::vec3 radiance =
+            integrator.integrate(ray, intersector, sky, sampler, &aov_sample);
+        aov.addSample(i, j, aov_sample);
+
+        if (!isinf(radiance) && !isnan(radiance)) {
+          image.addPixel(i, j, radiance);
+        }
+      }
+    }
+  }
+  image.divide(n_samples);
+  aov.resolve();
+
+  Denoiser denoiser;
+  denoiser.denoise(image, aov);
+
+  write_png("output.png", width, height, image.getConstPtr(), PostProcess());
+
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include <string>
+
+#include "bsdf.h"
+#include "camera.h"
+#include "checkpoint.h"
+#include "core.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "io.h"
+#include "primitive.h"
+#include "progressive.h"
+#include "sampler.h"
+#include "scene.h"
+#include "tile.h"
+
+int main()
+{
+  const int width = 512;
+  const int height = 512;
+  const int samples_per_pass = 4;
+  const int max_samples = 1000;
+  const float time_budget = 30.0f;
+  const float target_error = 0.01f;
+  const float output_interval = 5.0f;
+  const float checkpoint_interval = 10.0f;
+  const int max_depth = 10;
+  const int tile_size = 16;
+  const std::string scene_filepath = "./CornellBox.obj";
+
+  Image image(width, height);
+  PinholeCamera camera(glm::vec3(0, 1, 3), glm::vec3(0, 0, -1), 0.33f * M_PIf);
+
+  Scene scene;
+  scene.loadObj(scene_filepath);
+
+  BVHOptimized intersector(scene.m_primitives.data(),
+                           scene.m_primitives.size());
+  intersector.buildBVH();
+
+  IBL sky("PaperMill_E_3k.hdr");
+
+  SobolSampler sampler(12);
+
+  PathTracing integrator(max_depth);
+
+  TileScheduler scheduler(width, height, tile_size);
+
+  ProgressiveRendering renderer(samples_per_pass, max_samples, time_budget,
+                                target_error);
+  renderer.setIntermediateOutput("progress.png", output_interval);
+  // rerun after kill resumes from this file
+  // checkpoint file is named by hash of settings, so that renders of
+  // different settings don't share it
+  const uint64_t hash = settings_hash(
+      fmt::format("scene={} integrator=PathTracing sampler=SobolSampler "
+                  "max_depth={}",
+                  scene_filepath, max_depth));
+  renderer.setCheckpoint(fmt::format("progress_{:016x}.ckpt", hash),
+                         checkpoint_interval, hash);
+  renderer.render(camera, integrator, intersector, sky, sampler, scheduler,
+                  image);
+
+  write_png("output.png", width, height, image.getConstPtr(), PostProcess());
+
+  return 0;
+}
\ No newline at end of file
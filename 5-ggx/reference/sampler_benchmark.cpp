@@ -0,0 +1,109 @@
+#include <chrono>
+#include <vector>
+
+#include "pcg32x8.h"
+#include "sampler.h"
+#include "spdlog/spdlog.h"
+
+// measure ns per sample of given function, which generates n samples
+template <typename F>
+double benchmark(F f, size_t n, int n_repeats)
+{
+  f();  // warm up
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n_repeats; ++i) { f(); }
+  const auto end = std::chrono::steady_clock::now();
+
+  const double ns =
+      std::chrono::duration<double, std::nano>(end - start).count();
+  return ns / (static_cast<double>(n) * n_repeats);
+}
+
+int main()
+{
+  const size_t n_samples = 1 << 20;
+  const int n_repeats = 50;
+
+  std::vector<float> samples(n_samples);
+  float sink = 0.0f;
+
+#ifdef PCG32X8_SIMD
+  spdlog::info("[pcg32x8] SIMD: {}", PCG32X8_SIMD);
+#else
+  spdlog::info("[pcg32x8] SIMD: none(scalar fallback)");
+#endif
+
+  // check SIMD path produces same numbers as scalar path
+  pcg32x8_random_t rng_simd, rng_scalar;
+  pcg32x8_srandom_r(&rng_simd, 12, 0);
+  pcg32x8_srandom_r(&rng_scalar, 12, 0);
+  for (int k = 0; k < 1000; ++k) {
+    uint32_t x[8], y[8];
+    pcg32x8_random_r(&rng_simd, x);
+    pcg32x8_random_scalar_r(&rng_scalar, y);
+    for (int i = 0; i < 8; ++i) {
+      if (x[i] != y[i]) {
+        spdlog::error("[pcg32x8] mismatch at batch {}, lane {}", k, i);
+        return 1;
+      }
+    }
+  }
+
+  // check batch fill produces same numbers as scalar path
+  std::vector<float> batch(1000);
+  pcg32x8_fill_uniform(&rng_simd, batch.data(), batch.size());
+  for (size_t k = 0; k < batch.size(); k += 8) {
+    uint32_t y[8];
+    pcg32x8_random_scalar_r(&rng_scalar, y);
+    for (size_t i = 0; i < 8 && k + i < batch.size(); ++i) {
+      if (batch[k + i] != (y[i] >> 8) * (1.0f / (1u << 24))) {
+        spdlog::error("[pcg32x8_fill_uniform] mismatch at {}", k + i);
+        return 1;
+      }
+    }
+  }
+
+  // scalar sampler
+  RandomSampler sampler(12);
+  const double ns_sampler = benchmark(
+      [&]() {
+        for (size_t i = 0; i < n_samples; ++i) {
+          samples[i] = sampler.next_1d();
+        }
+        sink += samples[n_samples - 1];
+      },
+      n_samples, n_repeats);
+  spdlog::info("[RandomSampler::next_1d] {:.3f} ns/sample", ns_sampler);
+
+  // 8 interleaved streams without SIMD
+  pcg32x8_random_t rng;
+  pcg32x8_srandom_r(&rng, 12, 0);
+  const double ns_scalar = benchmark(
+      [&]() {
+        uint32_t x[8];
+        for (size_t i = 0; i < n_samples; i += 8) {
+          pcg32x8_random_scalar_r(&rng, x);
+          for (int k = 0; k < 8; ++k) {
+            samples[i + k] = (x[k] >> 8) * (1.0f / (1u << 24));
+          }
+        }
+        sink += samples[n_samples - 1];
+      },
+      n_samples, n_repeats);
+  spdlog::info("[pcg32x8 scalar] {:.3f} ns/sample", ns_scalar);
+
+  // 8 interleaved streams with SIMD
+  const double ns_batch = benchmark(
+      [&]() {
+        pcg32x8_fill_uniform(&rng, samples.data(), n_samples);
+        sink += samples[n_samples - 1];
+      },
+      n_samples, n_repeats);
+  spdlog::info("[pcg32x8_fill_uniform] {:.3f} ns/sample", ns_batch);
+
+  spdlog::info("speedup over RandomSampler: {:.2f}x", ns_sampler / ns_batch);
+  spdlog::info("(checksum: {})", sink);
+
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,370 @@
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bsdf.h"
+#include "camera.h"
+#include "core.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "io.h"
+#include "postprocess.h"
+#include "sampler.h"
+#include "scene_cache.h"
+#include "tile.h"
+
+// render job
+// sent as one line of whitespace separated key=value, for example
+// scene=./CornellBox.obj sky=PaperMill_E_3k.hdr width=512 height=512 spp=100
+// origin=0,1,3 forward=0,0,-1 fov=0.33 exposure=0 tonemap=aces
+// output=output.png
+struct RenderJob {
+  std::string scene_filepath;
+  std::string sky_filepath;
+  std::string output_filepath;
+  int width = 512;
+  int height = 512;
+  int n_samples = 100;
+  int max_depth = 10;
+  glm::vec3 origin = glm::vec3(0, 1, 3);
+  glm::vec3 forward = glm::vec3(0, 0, -1);
+  float fov = 0.33f;                         // field of view in units of pi
+  float exposure = 0.0f;                     // exposure compensation in EV
+  Tonemapper tonemapper = Tonemapper::NONE;  // tone mapping operator
+};
+
+// parse comma separated vector
+glm::vec3 parse_vec3(const std::string& str)
+{
+  glm::vec3 v;
+  char comma1, comma2;
+  std::istringstream ss(str);
+  if (!(ss >> v.x >> comma1 >> v.y >> comma2 >> v.z) || comma1 != ',' ||
+      comma2 != ',') {
+    throw std::runtime_error("invalid vector " + str);
+  }
+  return v;
+}
+
+RenderJob parse_job(const std::string& line)
+{
+  RenderJob job;
+  std::istringstream ss(line);
+  std::string token;
+  while (ss >> token) {
+    const size_t eq = token.find('=');
+    if (eq == std::string::npos) {
+      throw std::runtime_error("invalid token " + token);
+    }
+    const std::string key = token.substr(0, eq);
+    const std::string value = token.substr(eq + 1);
+
+    if (key == "scene") {
+      job.scene_filepath = value;
+    } else if (key == "sky") {
+      job.sky_filepath = value;
+    } else if (key == "output") {
+      job.output_filepath = value;
+    } else if (key == "width") {
+      job.width = std::stoi(value);
+    } else if (key == "height") {
+      job.height = std::stoi(value);
+    } else if (key == "spp") {
+      job.n_samples = std::stoi(value);
+    } else if (key == "depth") {
+      job.max_depth = std::stoi(value);
+    } else if (key == "origin") {
+      job.origin = parse_vec3(value);
+    } else if (key == "forward") {
+      job.forward = parse_vec3(value);
+    } else if (key == "fov") {
+      job.fov = std::stof(value);
+    } else if (key == "exposure") {
+      job.exposure = std::stof(value);
+    } else if (key == "tonemap") {
+      job.tonemapper = parse_tonemapper(value);
+    } else {
+      throw std::runtime_error("unknown key " + key);
+    }
+  }
+
+  if (job.scene_filepath.empty() || job.output_filepath.empty()) {
+    throw std::runtime_error("scene and output are required");
+  }
+  if (job.width <= 0 || job.height <= 0 || job.n_samples <= 0) {
+    throw std::runtime_error("invalid resolution or spp");
+  }
+  return job;
+}
+
+void render_job(const RenderJob& job, SceneCache& cache)
+{
+  const int width = job.width;
+  const int height = job.height;
+  const int tile_size = 16;
+
+  const auto scene = cache.getScene(job.scene_filepath);
+  std::shared_ptr<const Sky> sky;
+  if (job.sky_filepath.empty()) {
+    sky = std::make_shared<UniformSky>(glm::vec3(0.0f));
+  } else {
+    sky = cache.getSky(job.sky_filepath);
+  }
+  const Intersector& intersector = *scene->intersector;
+
+  Image image(width, height);
+  PinholeCamera camera(job.origin, job.forward, job.fov * M_PIf);
+
+  SobolSampler sampler(12);
+
+  PathTracing integrator(job.max_depth);
+
+  // threads of OpenMP are kept alive between jobs
+  TileScheduler scheduler(width, height, tile_size);
+  std::vector<SobolSampler> samplers(scheduler.getNumThreads(), sampler);
+
+  scheduler.render(image, [&](const Tile& tile, int thread_id,
+                              TileAccumulator& accumulation) {
+    SobolSampler& sampler = samplers[thread_id];
+    for (int j = tile.y0; j < tile.y1; ++j) {
+      for (int i = tile.x0; i < tile.x1; ++i) {
+        render_pixel(i, j, 0, job.n_samples, width, height, camera,
+                     integrator, intersector, *sky, sampler, accumulation);
+      }
+    }
+  });
+  scheduler.logStatistics();
+  image.divide(job.n_samples);
+
+  write_png(job.output_filepath, width, height, image.getConstPtr(),
+            PostProcess(job.exposure, job.tonemapper));
+}
+
+// worker threads which run render jobs in order of arrival
+// each job already uses all threads by TileScheduler, so a few workers are
+// enough to overlap scene loading and output of one job with rendering of
+// another
+class JobQueue
+{
+ public:
+  JobQueue(int n_workers)
+  {
+    for (int k = 0; k < n_workers; ++k) {
+      m_workers.emplace_back([this]() { run(); });
+    }
+  }
+
+  // queued jobs are finished before workers exit
+  ~JobQueue()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& worker : m_workers) { worker.join(); }
+  }
+
+  // return: result of job, available when job is done
+  std::future<std::string> submit(std::function<std::string()> job)
+  {
+    std::packaged_task<std::string()> task(std::move(job));
+    std::future<std::string> result = task.get_future();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_tasks.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+    return result;
+  }
+
+ private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::packaged_task<std::string()>> m_tasks;
+  std::vector<std::thread> m_workers;
+  bool m_stop = false;
+
+  void run()
+  {
+    while (true) {
+      std::packaged_task<std::string()> task;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [&]() { return m_stop || !m_tasks.empty(); });
+        if (m_tasks.empty()) { return; }
+        task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+      }
+      task();
+    }
+  }
+};
+
+// read one line from socket
+// return: false if connection is closed, or timed out, before newline
+bool read_line(int fd, std::string& line)
+{
+  line.clear();
+  char c;
+  ssize_t n;
+  while ((n = read(fd, &c, 1)) == 1) {
+    if (c == '\n') { return true; }
+    line += c;
+  }
+  // line without newline at end of stream is accepted
+  return n == 0 && !line.empty();
+}
+
+void write_line(int fd, const std::string& line)
+{
+  const std::string data = line + "\n";
+  size_t offset = 0;
+  while (offset < data.size()) {
+    // client may have disconnected, which shouldn't kill server by SIGPIPE
+    const ssize_t n = send(fd, data.data() + offset, data.size() - offset,
+                           MSG_NOSIGNAL);
+    if (n <= 0) { return; }
+    offset += n;
+  }
+}
+
+// state shared by connection threads
+struct Server {
+  int server_fd;
+  SceneCache cache;
+  JobQueue queue;
+  std::atomic<bool> running{true};
+
+  // number of connection threads, main waits them before exit
+  std::mutex mutex;
+  std::condition_variable cv;
+  int n_connections = 0;
+
+  Server(int server_fd, int n_workers)
+      : server_fd(server_fd), queue(n_workers)
+  {
+  }
+};
+
+// read job from client, run it on job queue and reply result
+void handle_connection(int client_fd, Server& server)
+{
+  // client which doesn't send a line is dropped after timeout
+  timeval timeout = {};
+  timeout.tv_sec = 10;
+  setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  std::string line;
+  if (!read_line(client_fd, line)) {
+    spdlog::warn("[server] connection closed without job");
+  } else if (line == "quit") {
+    write_line(client_fd, "ok");
+    // wake up accept of main thread
+    server.running = false;
+    shutdown(server.server_fd, SHUT_RDWR);
+  } else {
+    spdlog::info("[server] job: {}", line);
+    std::future<std::string> result = server.queue.submit([&]() {
+      const auto start = std::chrono::steady_clock::now();
+      try {
+        render_job(parse_job(line), server.cache);
+        const float elapsed = std::chrono::duration<float>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+        spdlog::info("[server] job done in {:.3f}s", elapsed);
+        return "ok " + std::to_string(elapsed);
+      } catch (const std::exception& e) {
+        spdlog::error("[server] {}", e.what());
+        return std::string("error ") + e.what();
+      }
+    });
+    write_line(client_fd, result.get());
+  }
+  close(client_fd);
+
+  std::lock_guard<std::mutex> lock(server.mutex);
+  server.n_connections--;
+  server.cv.notify_all();
+}
+
+// render server
+// usage: server [socket_path] [n_workers]
+// each connection sends one job line and receives "ok <seconds>" or
+// "error <message>" when the job is done. "quit" stops the server after
+// running jobs are done.
+// connections are handled by their own threads, and jobs run on a shared
+// queue of n_workers(1) threads, while loaded scenes, textures and bvhs are
+// cached between jobs.
+// example: echo "scene=./CornellBox.obj output=out.png" |
+//          socat - UNIX-CONNECT:/tmp/ggx-render.sock
+int main(int argc, char** argv)
+{
+  const std::string socket_path =
+      argc > 1 ? argv[1] : "/tmp/ggx-render.sock";
+  const int n_workers = argc > 2 ? std::max(std::stoi(argv[2]), 1) : 1;
+
+  const int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server_fd < 0) {
+    spdlog::error("[server] failed to create socket");
+    return EXIT_FAILURE;
+  }
+
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    spdlog::error("[server] socket path is too long");
+    return EXIT_FAILURE;
+  }
+  socket_path.copy(addr.sun_path, socket_path.size());
+
+  // remove socket left by previous server
+  unlink(socket_path.c_str());
+  if (bind(server_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      listen(server_fd, 16) < 0) {
+    spdlog::error("[server] failed to listen on {}", socket_path);
+    return EXIT_FAILURE;
+  }
+  spdlog::info("[server] listening on {} with {} workers", socket_path,
+               n_workers);
+
+  {
+    Server server(server_fd, n_workers);
+    while (server.running) {
+      const int client_fd = accept(server_fd, nullptr, nullptr);
+      if (client_fd < 0) { continue; }
+
+      {
+        std::lock_guard<std::mutex> lock(server.mutex);
+        server.n_connections++;
+      }
+      std::thread(handle_connection, client_fd, std::ref(server)).detach();
+    }
+
+    // wait connections, whose jobs may still be queued
+    std::unique_lock<std::mutex> lock(server.mutex);
+    server.cv.wait(lock, [&]() { return server.n_connections == 0; });
+  }
+
+  close(server_fd);
+  unlink(socket_path.c_str());
+
+  return 0;
+}
\ No newline at end of file
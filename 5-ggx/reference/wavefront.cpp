@@ -0,0 +1,112 @@
+#include <chrono>
+#include <cstdlib>
+
+#include "bsdf.h"
+#include "camera.h"
+#include "core.h"
+#include "image.h"
+#include "integrator.h"
+#include "intersector.h"
+#include "io.h"
+#include "light.h"
+#include "metrics.h"
+#include "primitive.h"
+#include "sampler.h"
+#include "scene.h"
+#include "wavefront.h"
+
+int main()
+{
+  const int width = 512;
+  const int height = 512;
+  const int n_samples = 100;
+  const int max_depth = 10;
+  // both render the same estimator with the same samples, so images differ
+  // only by floating point rounding
+  const double max_rel_mse = 1e-4;
+
+  PinholeCamera camera(glm::vec3(0, 1, 3), glm::vec3(0, 0, -1), 0.33f * M_PIf);
+
+  Scene scene;
+  scene.loadObj("./CornellBox.obj");
+
+  BVHOptimized intersector(scene.m_primitives.data(),
+                           scene.m_primitives.size());
+  intersector.buildBVH();
+
+  IBL sky("PaperMill_E_3k.hdr");
+
+  SobolSampler sampler(12);
+
+  PowerLightSampler light_sampler(scene.m_lights.data(),
+                                  scene.m_lights.size());
+
+  // megakernel(one path at a time)
+  Image image_megakernel(width, height);
+  const PathTracingNEE path_tracing_nee(max_depth, &light_sampler);
+  const Integrator& integrator = path_tracing_nee;
+
+  const auto megakernel_start = std::chrono::steady_clock::now();
+#pragma omp parallel for collapse(2) firstprivate(sampler)
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      for (int k = 0; k < n_samples; ++k) {
+        sampler.startPixelSample(i + width * j, k);
+
+        const glm::vec2 u_pixel = sampler.next_2d();
+        glm::vec2 ndc = glm::vec2((2.0f * (i + u_pixel.x) - width) / height,
+                                  (2.0f * (j + u_pixel.y) - height) / height);
+        ndc.y *= -1.0f;
+
+        // sample ray from camera
+        const Ray ray = camera.sampleRay(ndc, sampler.next_2d());
+
+        // evaluate incoming radiance
+        const glm::vec3 radiance =
+            integrator.integrate(ray, intersector, sky, sampler);
+
+        if (!isinf(radiance) && !isnan(radiance)) {
+          image_megakernel.addPixel(i, j, radiance);
+        }
+      }
+    }
+  }
+  const auto megakernel_end = std::chrono::steady_clock::now();
+
+  // wavefront
+  Image image(width, height);
+  WavefrontPathTracing wavefront(max_depth, &light_sampler, true, true);
+
+  const auto wavefront_start = std::chrono::steady_clock::now();
+  wavefront.render(camera, intersector, sky, sampler, n_samples, image);
+  const auto wavefront_end = std::chrono::steady_clock::now();
+
+  // check that wavefront renders the same image before comparing speed
+  image_megakernel.divide(n_samples);
+  image.divide(n_samples);
+  const double error = rel_mse(image.getConstPtr(),
+                               image_megakernel.getConstPtr(), width, height);
+  spdlog::info("[wavefront] relMSE to megakernel: {:.6e}", error);
+  if (!(error <= max_rel_mse)) {
+    spdlog::error("[wavefront] relMSE exceeds {:.6e}", max_rel_mse);
+    return EXIT_FAILURE;
+  }
+
+  // compare throughput
+  const double n_paths = static_cast<double>(width) * height * n_samples;
+  const double megakernel_ms = std::chrono::duration<double, std::milli>(
+                                   megakernel_end - megakernel_start)
+                                   .count();
+  const double wavefront_ms = std::chrono::duration<double, std::milli>(
+                                  wavefront_end - wavefront_start)
+                                  .count();
+  spdlog::info("[megakernel] {:.1f} ms, {:.2f} M samples/s", megakernel_ms,
+               1e-3 * n_paths / megakernel_ms);
+  spdlog::info("[wavefront] {:.1f} ms, {:.2f} M samples/s", wavefront_ms,
+               1e-3 * n_paths / wavefront_ms);
+  spdlog::info("[wavefront] speedup: {:.2f}x", megakernel_ms / wavefront_ms);
+
+  write_png("output.png", width, height, image.getConstPtr(), PostProcess());
+
+  return 0;
+}
\ No newline at end of file